@@ -12,11 +12,43 @@
 
 #include <spdlog/spdlog.h>
 
+#include "../string_utils.h"
+
 #define PA_SAMPLE_TYPE  paFloat32
 typedef float SAMPLE;
 
 #define SAMPLES_PER_BUFFER 512
 
+//capture ring size in speech check periods, how far the chunk thread can fall behind before audio is dropped
+const uint32_t capture_ring_checks = 4;
+
+//how often the chunk thread collects from the capture ring
+const useconds_t chunk_poll_us = 10*1000;
+
+//how often the capture counters are logged
+const std::chrono::seconds capture_report_interval(60);
+
+//spare check period buffers passed back from the speech thread to the chunk thread for reuse
+const size_t free_chunk_buffers = 4;
+
+//transcribed speech waiting for check_for_speech
+const size_t result_backlog = 4;
+
+//how long check_for_speech waits for a result
+const int result_wait_ms = 100;
+
+//audio kept ahead of speech detected by the streaming vad, which only triggers some way into the first word
+const uint32_t stream_pre_roll_ms = 500;
+
+static bool stream_vad_mode(const std::string& mode) {
+  if(mode == "stream") {
+    return true;
+  } else if(mode != "chunk") {
+    spdlog::warn("unknown audio vadMode \"{}\", checking whole chunks", mode);
+  }
+  return false;
+}
+
 
 
 typedef struct {
@@ -41,12 +73,40 @@ typedef struct {
 
 
 
-audio_wrapper::audio_wrapper(YAML::Node config, whisper_wrapper& w, std::atomic<bool>& cancel) : _thread_ctrl(cancel), _whisp(w) {
+audio_wrapper::audio_wrapper(YAML::Node config, whisper_wrapper& w, std::atomic<bool>& cancel)
+  : _thread_ctrl(cancel), _samples_per_second(config["samplesPerSec"].as<uint32_t>()),
+    _samples_per_check(config["samplesPerCheck"].as<uint32_t>()), _whisp(w),
+    _stream_vad(stream_vad_mode(config["vadMode"].as<std::string>())), _vad(config, w, _samples_per_second),
+    _chunk_samples(_stream_vad ? _vad.hop_samples() : _samples_per_check),
+    _gate(config, float(_chunk_samples) / _samples_per_second),
+    _capture(_samples_per_check * capture_ring_checks),
+    //chunkBacklog is in check periods whatever the chunk size
+    _chunks(std::max<size_t>(config["chunkBacklog"].as<size_t>() * _samples_per_check / _chunk_samples, 1),
+            config["backlogDropOldest"].as<bool>()),
+    _chunk_free(free_chunk_buffers, false),
+    _results(result_backlog, true) {
   _stream = nullptr;
 
   _mic_dev = config["device"].as<std::string>();
-  _samples_per_second = config["samplesPerSec"].as<uint32_t>();
-  _samples_per_check = config["samplesPerCheck"].as<uint32_t>();
+
+  _spot_activation = config["activationSpotting"].as<bool>();
+  _spot_samples = _samples_per_second * config["activationSpotMs"].as<uint32_t>() / 1000;
+  //command words first, the control thread also checks for them before ai words
+  for(const auto& key: {"cmdActivationWords", "aiActivationWords"}) {
+    utterance_kind kind = std::string(key) == "cmdActivationWords" ? utterance_command : utterance_ai;
+    for(const auto& word: config[key].as<std::vector<std::string>>()) {
+      _activation_words.push_back({word, kind});
+    }
+  }
+  _speech_start = 0;
+  _spot_passed.store(0);
+  _spot_rejected.store(0);
+
+  _input_overflows.store(0);
+  _reported_overruns = 0;
+  _audio_buffer.reserve(_chunk_samples);
+  _playing.store(false);
+  _clear_requested.store(false);
 
 
   if(SDL_Init(SDL_INIT_AUDIO) == -1) {
@@ -69,8 +129,10 @@ audio_wrapper::audio_wrapper(YAML::Node config, whisper_wrapper& w, std::atomic<
 
 audio_wrapper::~audio_wrapper() {
 
+  _thread_ctrl.store(false);
+  stop_threads();
+
   if(_stream != nullptr) {
-    _thread_ctrl.store(false);
     PaError err;
 
     while( ( err = Pa_IsStreamActive( _stream ) ) == 1 ) {
@@ -123,9 +185,25 @@ int audio_wrapper::start() {
     return -3;
   }
 
+  if(!_chunk_thread.joinable()) {
+    _chunk_thread = std::thread(&audio_wrapper::chunk_handler, this);
+  }
+  if(!_speech_thread.joinable()) {
+    _speech_thread = std::thread(&audio_wrapper::speech_handler, this);
+  }
+
   return 0;
 }
 
+void audio_wrapper::stop_threads() {
+  if(_chunk_thread.joinable()) {
+    _chunk_thread.join();
+  }
+  if(_speech_thread.joinable()) {
+    _speech_thread.join();
+  }
+}
+
 int audio_wrapper::play_from_mem(std::vector<uint8_t>& audio_arr) {
 
   SDL_RWops* rw = SDL_RWFromMem(audio_arr.data(), audio_arr.size());
@@ -140,6 +218,7 @@ int audio_wrapper::play_from_mem(std::vector<uint8_t>& audio_arr) {
     return -2;
   }
 
+  _playing.store(true);
   while(1) {
     if(!Mix_PlayingMusic()) {
       break;
@@ -147,6 +226,8 @@ int audio_wrapper::play_from_mem(std::vector<uint8_t>& audio_arr) {
     usleep(1000);
   }
 
+  _playing.store(false);
+
   Mix_FreeMusic(audio);
   audio = NULL;
   return 0;
@@ -166,6 +247,7 @@ int audio_wrapper::play_from_file(const std::string filename) {
     return -2;
   }
 
+  _playing.store(true);
   while(1) {
     if(!Mix_PlayingMusic()) {
       break;
@@ -173,6 +255,8 @@ int audio_wrapper::play_from_file(const std::string filename) {
     usleep(1000);
   }
 
+  _playing.store(false);
+
   Mix_FreeMusic(audio_file);
   audio_file = NULL;
   return 0;
@@ -226,94 +310,322 @@ int audio_wrapper::recordCallback( const void *inputBuffer, unsigned long frames
     return paComplete;
   }
 
+  if(statusFlags & paInputOverflow) {
+    _input_overflows.fetch_add(1, std::memory_order_relaxed);
+  }
+
   if( inputBuffer != NULL ) {
-    //add data to audio_buffer
-    for(size_t i = 0; i < framesPerBuffer; i++) {
-      _audio_buffer.push_back(in[i]);
+    //runs on the portaudio real time thread: no allocation or locking, the chunk thread takes it from here
+    _capture.write(in, framesPerBuffer);
+  }
+
+  return paContinue;
+}
+
+int audio_wrapper::check_for_speech(std::vector<uint8_t>& speech, std::string& estimated_text, bool muted)
+{
+  speech_result result;
+  if(!_results.pop(result, result_wait_ms)) {
+    return 0;
+  }
+  if(result.status == 0) {
+    //the speech thread found the end of speech, let the user know before transcription finishes
+    if(!muted) play_from_file("./samples/beep_short.mp3");
+    return 0;
+  }
+  if(result.status < 0) {
+    return result.status;
+  }
+
+  speech.swap(result.wav);
+  estimated_text.swap(result.text);
+  return 1;
+}
+
+void audio_wrapper::chunk_handler()
+{
+  auto report_time = std::chrono::steady_clock::now();
+  uint64_t reported_spotted = 0;
+  std::vector<float> dropped;
+  std::vector<float> spare;
+  while(_thread_ctrl.load()) {
+    if(std::chrono::steady_clock::now() - report_time >= capture_report_interval) {
+      report_time = std::chrono::steady_clock::now();
+      capture_stats stats = get_capture_stats();
+      spdlog::debug("audio capture: {} overruns ({} samples), {} input overflows, {} chunks dropped, {} gated / {} evaluated, "
+                    "activation {} passed / {} rejected", stats.overruns, stats.dropped_samples, stats.input_overflows,
+                    stats.dropped_chunks, stats.gated_chunks, stats.evaluated_chunks, stats.activation_passed,
+                    stats.activation_rejected);
+
+      uint64_t spotted = stats.activation_passed + stats.activation_rejected;
+      if(spotted != reported_spotted) {
+        reported_spotted = spotted;
+        spdlog::info("activation spotting has rejected {} of {} segments ({:.0f}%)", stats.activation_rejected, spotted,
+                     100.0 * stats.activation_rejected / spotted);
+      }
+    }
+
+    //while we play output the microphone only hears us, and after an overrun what is queued is no longer contiguous
+    if(_playing.load() || _capture.overruns() != _reported_overruns) {
+      if(_capture.overruns() != _reported_overruns) {
+        _reported_overruns = _capture.overruns();
+        spdlog::debug("audio chunking fell behind, {} blocks ({} samples) dropped so far", _reported_overruns, _capture.dropped());
+      }
+      _capture.clear();
+      _audio_buffer.clear();
+      usleep(chunk_poll_us);
+      continue;
     }
 
-    if (_audio_buffer.size() >= _samples_per_check) {
-      std::unique_lock<std::recursive_mutex> accessLock(_audio_mutex);
-      _audio_to_check.clear();
-      _audio_to_check.swap(_audio_buffer);
-      _audio_pending = true;
+    //collect a full chunk of samples from the capture ring, into a buffer the speech thread has finished with
+    if(_audio_buffer.empty() && _chunk_free.try_pop(_audio_buffer)) {
+      _audio_buffer.clear();
     }
+    size_t old_size = _audio_buffer.size();
+    _audio_buffer.resize(_chunk_samples);
+    _audio_buffer.resize(old_size + _capture.read(_audio_buffer.data() + old_size, _chunk_samples - old_size));
 
+    if(_audio_buffer.size() < _chunk_samples) {
+      usleep(chunk_poll_us);
+      continue;
+    }
+
+    if(_chunks.push(_audio_buffer, dropped)) {
+      spdlog::warn("speech processing fell behind, {} audio chunks dropped so far", _chunks.dropped());
+      _chunk_free.push(dropped, spare);
+    }
+    _audio_buffer.clear();
   }
+}
 
-  return paContinue;
+void audio_wrapper::speech_handler()
+{
+  std::vector<float> spare;
+  while(_thread_ctrl.load()) {
+    //the buffer checked last time goes back to the chunk thread before the next one is taken
+    if(_audio_to_check.capacity()) {
+      _chunk_free.push(_audio_to_check, spare);
+    }
+    bool have_chunk = _chunks.pop(_audio_to_check, 100);
+
+    if(_clear_requested.exchange(false)) {
+      //drop everything captured up to now
+      std::vector<float> stale;
+      while(_chunks.try_pop(stale)) {
+        _chunk_free.push(stale, spare);
+      }
+      _speech_segment.clear();
+      _pre_speech.clear();
+      _vad.reset();
+      continue;
+    }
+
+    if(!have_chunk) {
+      continue;
+    }
+
+    if(_stream_vad) {
+      //may post several results, one per utterance ended within the hop
+      process_stream_chunk();
+      continue;
+    }
+
+    speech_result result;
+    if(process_chunk(result)) {
+      post_result(result);
+    }
+  }
 }
 
-int audio_wrapper::check_for_speech(std::vector<uint8_t>& speech, std::string& estimated_text, bool muted)
+void audio_wrapper::post_result(speech_result& result)
 {
-  bool speech_to_process = false;
+  //speech from before a clear that was still being transcribed is dropped too
+  if(_clear_requested.load()) {
+    return;
+  }
 
-  {
-    std::unique_lock<std::recursive_mutex> accessLock(_audio_mutex);
-    if(_audio_pending) {
-      _audio_pending = false;
-      //we have audio in buffer, check it for speech
-
-      int vad_result = _whisp.contains_speech(_audio_to_check);
-      if(vad_result < 0) {
-        return -2;
-      } else if (vad_result > 0) {
-
-        //speech found
-        if(!_speech_segment.size()) {
-          _speech_segment.swap(_pre_speech);
-        }
-        std::copy(_audio_to_check.begin(), _audio_to_check.end(), std::back_inserter(_speech_segment));
-      } else {
-        //no speech
-        if(_speech_segment.size()) {
-          //end of speech (there was previous speech found)
-
-          //add additional background to end of speech
-          std::copy(_audio_to_check.begin(), _audio_to_check.end(), std::back_inserter(_speech_segment));
-
-          //copy speech segments into output wav format
-          size_t numBytes = _speech_segment.size() * sizeof(float);
-          speech.clear();
-          speech.resize(numBytes + sizeof(wav_hdr_t));
-          {
-            wav_hdr_t wav;
-            wav.ChunkSize = numBytes + 36;
-            wav.Subchunk2Size = numBytes;
-            wav.SamplesPerSec = _samples_per_second;   // Sampling Frequency in Hz
-            wav.bytesPerSec = _samples_per_second * sizeof(SAMPLE); // bytes per second
-            uint8_t *p = (uint8_t *)&wav;
-            for(size_t i = 0; i < sizeof(wav_hdr_t); i++) {
-              speech[i] = p[i];
-            }
-          }
-          std::memcpy(&speech[sizeof(wav_hdr_t)], (uint8_t*)_speech_segment.data(), numBytes);
-          speech_to_process = true;
-          if(!muted) play_from_file("./samples/beep_short.mp3");
-        } else {
-          //no speech and previous also wasn't speech
-
-          //fill pre speech ready to be added before speech
-          _pre_speech.swap(_audio_to_check);
-        }
+  speech_result dropped;
+  if(_results.push(result, dropped)) {
+    spdlog::warn("speech results were not collected in time, dropped");
+  }
+}
+
+int audio_wrapper::process_chunk(speech_result& result)
+{
+  //check the chunk for speech
+  int vad_result = 0;
+  if(!_gate.is_silence(_audio_to_check.data(), _audio_to_check.size())) {
+    vad_result = _whisp.contains_speech(_audio_to_check);
+    if(!vad_result) {
+      _gate.no_speech();
+    }
+  }
+  if(vad_result < 0) {
+    result.status = -2;
+    return 1;
+  } else if (vad_result > 0) {
+
+    //speech found
+    if(!_speech_segment.size()) {
+      _speech_segment.swap(_pre_speech);
+      _speech_start = _speech_segment.size();
+    }
+    std::copy(_audio_to_check.begin(), _audio_to_check.end(), std::back_inserter(_speech_segment));
+  } else {
+    //no speech
+    if(_speech_segment.size()) {
+      //end of speech (there was previous speech found)
+
+      //add additional background to end of speech
+      std::copy(_audio_to_check.begin(), _audio_to_check.end(), std::back_inserter(_speech_segment));
+      return finish_segment(result);
+    } else {
+      //no speech and previous also wasn't speech
+
+      //fill pre speech ready to be added before speech
+      _pre_speech.swap(_audio_to_check);
+    }
+  }
+
+  return 0;
+}
+
+void audio_wrapper::process_stream_chunk()
+{
+  bool silent = _gate.is_silence(_audio_to_check.data(), _audio_to_check.size());
+  //whether the hop had any speech in it, including the end of an utterance that started in an earlier hop
+  bool heard = _vad.in_speech();
+  if((silent ? _vad.silence(_audio_to_check, _vad_events) : _vad.process(_audio_to_check, _vad_events)) < 0) {
+    speech_result result;
+    result.status = -2;
+    post_result(result);
+    return;
+  }
+
+  //walk the hop window by window, so speech that starts and ends within one hop isn't lost
+  const size_t window = streaming_vad::window_samples();
+  const size_t pre_roll = size_t(_samples_per_second) * stream_pre_roll_ms / 1000;
+  for(size_t pos = 0, i = 0; pos < _audio_to_check.size(); pos += window, i++) {
+    int event = i < _vad_events.size() ? _vad_events[i] : vad_none;
+    auto begin = _audio_to_check.begin() + pos;
+    auto end = _audio_to_check.begin() + std::min(pos + window, _audio_to_check.size());
+
+    if(event != vad_none) {
+      heard = true;
+    }
+
+    if(event == vad_speech_start) {
+      _speech_segment.swap(_pre_speech);
+      _speech_start = _speech_segment.size();
+      _pre_speech.clear();
+    }
+
+    if(event == vad_speech_start || _speech_segment.size()) {
+      std::copy(begin, end, std::back_inserter(_speech_segment));
+    } else {
+      //keep a short pre roll ready to be added before speech
+      std::copy(begin, end, std::back_inserter(_pre_speech));
+      if(_pre_speech.size() > pre_roll) {
+        _pre_speech.erase(_pre_speech.begin(), _pre_speech.end() - pre_roll);
+      }
+    }
+
+    if(event == vad_speech_end && _speech_segment.size()) {
+      speech_result result;
+      if(finish_segment(result)) {
+        post_result(result);
       }
     }
   }
 
-  if(speech_to_process) {
-    spdlog::info("Found speech, processing locally");
+  if(!silent && !heard) {
+    _gate.no_speech();
+  }
+}
 
-    if(_whisp.convert_audio_to_text(_speech_segment, _speech_segment.size(), estimated_text)) {
-      _speech_segment.clear();
-      return -5;
+int audio_wrapper::finish_segment(speech_result& result)
+{
+  {
+    speech_result ended;
+    ended.status = 0;
+    post_result(ended);
+  }
+
+  //copy speech segments into output wav format
+  size_t numBytes = _speech_segment.size() * sizeof(float);
+  result.wav.resize(numBytes + sizeof(wav_hdr_t));
+  {
+    wav_hdr_t wav;
+    wav.ChunkSize = numBytes + 36;
+    wav.Subchunk2Size = numBytes;
+    wav.SamplesPerSec = _samples_per_second;   // Sampling Frequency in Hz
+    wav.bytesPerSec = _samples_per_second * sizeof(SAMPLE); // bytes per second
+    uint8_t *p = (uint8_t *)&wav;
+    for(size_t i = 0; i < sizeof(wav_hdr_t); i++) {
+      result.wav[i] = p[i];
     }
+  }
+  std::memcpy(&result.wav[sizeof(wav_hdr_t)], (uint8_t*)_speech_segment.data(), numBytes);
+
+  spdlog::info("Found speech, processing locally");
+
+  result.status = 1;
+  utterance_kind kind = utterance_any;
+  if(_spot_activation && !spot_activation(result.text, kind)) {
+    //what was heard of the start is enough for the control thread to ignore it
     _speech_segment.clear();
     return 1;
   }
 
-  return 0;
+  if(_whisp.convert_audio_to_text(_speech_segment, _speech_segment.size(), result.text, kind)) {
+    result.status = -5;
+  }
+  _speech_segment.clear();
+  return 1;
+}
+
+bool audio_wrapper::spot_activation(std::string& text, utterance_kind& kind)
+{
+  //the window starts where speech was found, not at the pre speech background added in front of it
+  size_t start = std::min(_speech_start, _speech_segment.size());
+  size_t samples = std::min<size_t>(_speech_segment.size() - start, _spot_samples);
+  if(_whisp.spot_text(_speech_segment.data() + start, samples, text)) {
+    //leave it to the full transcription
+    return true;
+  }
+
+  std::string heard = trim_and_lowercase(text);
+  for(const auto& word: _activation_words) {
+    if(heard.find(word.first) != std::string::npos) {
+      kind = word.second;
+      _spot_passed++;
+      return true;
+    }
+  }
+
+  uint64_t rejected = ++_spot_rejected;
+  spdlog::debug("No activation word heard (\"{}\"), skipping transcription ({} of {} segments rejected)", heard,
+               rejected, rejected + _spot_passed.load());
+  return false;
 }
 
 void audio_wrapper::clear_speech_buffer() {
-  _speech_segment.clear();
+  _clear_requested.store(true);
+
+  //results already waiting are from before the clear (the speech thread drops the rest)
+  speech_result stale;
+  while(_results.try_pop(stale)) {}
+}
+
+audio_wrapper::capture_stats audio_wrapper::get_capture_stats() const {
+  capture_stats stats;
+  stats.overruns = _capture.overruns();
+  stats.dropped_samples = _capture.dropped();
+  stats.input_overflows = _input_overflows.load(std::memory_order_relaxed);
+  stats.dropped_chunks = _chunks.dropped();
+  stats.gated_chunks = _gate.gated();
+  stats.evaluated_chunks = _gate.evaluated();
+  stats.activation_passed = _spot_passed.load();
+  stats.activation_rejected = _spot_rejected.load();
+  return stats;
 }
@@ -10,6 +10,10 @@
 #include <portaudio.h>
 
 #include "whisper_wrapper.h"
+#include "sample_ring.h"
+#include "streaming_vad.h"
+#include "energy_gate.h"
+#include "../frame_queue.h"
 
 
 class audio_wrapper {
@@ -28,6 +32,23 @@ public:
 
   void list_mics() const;
 
+  struct capture_stats {
+    //capture blocks the chunking thread didn't collect in time, and the samples they held
+    uint64_t overruns;
+    uint64_t dropped_samples;
+    //overflows reported by portaudio
+    uint64_t input_overflows;
+    //check periods dropped by the backlog policy because speech processing fell behind
+    uint64_t dropped_chunks;
+    //chunks the energy gate found to be silence, and chunks passed on to the vad
+    uint64_t gated_chunks;
+    uint64_t evaluated_chunks;
+    //speech segments whose start did and didn't contain an activation word
+    uint64_t activation_passed;
+    uint64_t activation_rejected;
+  };
+  capture_stats get_capture_stats() const;
+
 private:
 
   std::atomic<bool>& _thread_ctrl;
@@ -39,22 +60,69 @@ private:
 
   whisper_wrapper& _whisp;
 
+  //vadMode "stream" checks short hops with frame level vad instead of whole check periods
+  bool _stream_vad;
+  streaming_vad _vad;
+  //samples per chunk handed to the speech thread (a check period or a vad hop)
+  uint32_t _chunk_samples;
+  //skips the vad for chunks that are clearly silence
+  energy_gate _gate;
+
+  //segments are only transcribed in full when a quick transcription of their start contains an activation word
+  bool _spot_activation;
+  uint32_t _spot_samples;
+  std::vector<std::pair<std::string, utterance_kind>> _activation_words;
+  std::atomic<uint64_t> _spot_passed;
+  std::atomic<uint64_t> _spot_rejected;
+
+  //filled by the record callback, cut into check periods by the chunk thread
+  sample_ring _capture;
+  std::atomic<uint64_t> _input_overflows;
+  uint64_t _reported_overruns;
   std::vector<float> _audio_buffer;
-  std::vector<float> _pre_speech;
 
-  std::recursive_mutex _audio_mutex;
-  std::vector<float> _audio_to_check;
-  bool _audio_pending;
+  //check periods waiting for the speech thread, bounded by chunkBacklog
+  frame_queue<std::vector<float>> _chunks;
+  //buffers the speech thread has finished with, reused by the chunk thread
+  frame_queue<std::vector<float>> _chunk_free;
 
-  PaStream* _stream;
+  //speech detection and transcription results waiting for check_for_speech
+  struct speech_result {
+    //1 transcribed, 0 end of speech found (transcription follows), < 0 failed
+    int status;
+    std::vector<uint8_t> wav;
+    std::string text;
+  };
+  frame_queue<speech_result> _results;
+
+  //set while we play output (the microphone would only hear us), and when the control thread wants speech discarded
+  std::atomic<bool> _playing;
+  std::atomic<bool> _clear_requested;
 
+  std::thread _chunk_thread;
+  std::thread _speech_thread;
 
+  //owned by the speech thread
+  std::vector<float> _pre_speech;
+  std::vector<float> _audio_to_check;
+  std::vector<int> _vad_events;
   std::vector<float> _speech_segment;
+  //where the speech itself starts in _speech_segment, after the pre speech
+  size_t _speech_start;
+
+  PaStream* _stream;
 
 
   int find_device_id(const std::string device_name) const;
 
-  void thread_handler();
+  void stop_threads();
+  void chunk_handler();
+  void speech_handler();
+  int process_chunk(speech_result& result);
+  void process_stream_chunk();
+  int finish_segment(speech_result& result);
+  void post_result(speech_result& result);
+  bool spot_activation(std::string& text, utterance_kind& kind);
 
   int recordCallback(const void *inputBuffer, unsigned long framesPerBuffer,
                       PaStreamCallbackFlags statusFlags);
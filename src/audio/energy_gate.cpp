@@ -0,0 +1,94 @@
+#include "energy_gate.h"
+
+#include <opencv2/core/hal/intrin.hpp>
+
+#include <cmath>
+#include <algorithm>
+
+//time constant of the noise floor following a louder background (it drops to a quieter one straight away)
+const float noise_rise_seconds = 2.0f;
+
+//sum of squares and number of sign changes between neighbouring samples, in one pass
+static void measure(const float* x, size_t n, float& energy, uint32_t& crossings) {
+  energy = x[0] * x[0];
+  crossings = 0;
+  size_t i = 1;
+
+#if CV_SIMD128
+  using namespace cv;
+  const v_float32x4 zero = v_setzero_f32();
+  v_float32x4 acc = v_setzero_f32();
+  v_uint32x4 changes = v_setzero_u32();
+  for(; i + 4 <= n; i += 4) {
+    v_float32x4 cur = v_load(x + i);
+    v_float32x4 prev = v_load(x + i - 1);
+    acc = v_muladd(cur, cur, acc);
+    //differing sign masks are all ones, subtracting counts them
+    changes = changes - v_reinterpret_as_u32((cur >= zero) ^ (prev >= zero));
+  }
+  energy += v_reduce_sum(acc);
+  crossings += v_reduce_sum(changes);
+#endif
+
+  for(; i < n; i++) {
+    energy += x[i] * x[i];
+    crossings += (x[i] >= 0.0f) != (x[i - 1] >= 0.0f);
+  }
+}
+
+energy_gate::energy_gate(YAML::Node config, float chunk_seconds) {
+  _enabled = config["vadGate"].as<bool>();
+  _margin = config["gateMargin"].as<float>();
+  _silence_rms = config["gateSilenceRms"].as<float>();
+  _zcr_delta = config["gateZcrDelta"].as<float>();
+
+  _noise_rise = 1.0f - std::exp(-chunk_seconds / noise_rise_seconds);
+  _noise_rms = _silence_rms;
+  _noise_zcr = -1.0f;
+  _last_rms = 0;
+  _last_zcr = 0;
+
+  _gated.store(0);
+  _evaluated.store(0);
+}
+
+bool energy_gate::is_silence(const float* samples, size_t count) {
+  if(!_enabled || !count) {
+    _evaluated++;
+    return false;
+  }
+
+  float energy;
+  uint32_t crossings;
+  measure(samples, count, energy, crossings);
+  _last_rms = std::sqrt(energy / count);
+  _last_zcr = float(crossings) / count;
+
+  //quiet enough to be silence whatever it sounds like, or at the noise floor and sounding like the noise
+  bool silence = _last_rms < _silence_rms ||
+                 (_last_rms < _noise_rms * _margin && _noise_zcr >= 0 && std::fabs(_last_zcr - _noise_zcr) < _zcr_delta);
+
+  if(silence) {
+    //gated audio may only lower the floor, soft speech let through as silence must not raise it (and with it the
+    //level that is gated next), a louder background is only followed once the vad confirms it through no_speech
+    if(_last_rms <= _noise_rms) {
+      learn_noise(_last_rms, _last_zcr);
+    }
+    _gated++;
+  } else {
+    _evaluated++;
+  }
+  return silence;
+}
+
+void energy_gate::no_speech() {
+  if(_enabled) {
+    learn_noise(_last_rms, _last_zcr);
+  }
+}
+
+void energy_gate::learn_noise(float rms, float zcr) {
+  rms = std::max(rms, _silence_rms);
+  _noise_rms = rms < _noise_rms ? rms : _noise_rms + (rms - _noise_rms) * _noise_rise;
+  _noise_zcr = _noise_zcr < 0 ? zcr : _noise_zcr + (zcr - _noise_zcr) * _noise_rise;
+}
@@ -0,0 +1,51 @@
+#ifndef __ENERGY_GATE_H__
+#define __ENERGY_GATE_H__
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <yaml-cpp/yaml.h>
+
+//cheap check in front of the neural vad: audio near the background noise floor in both energy
+//and zero crossing rate is treated as silence, anything borderline is passed on to the vad
+class energy_gate {
+public:
+  //chunk_seconds is the length of audio checked per call
+  energy_gate(YAML::Node config, float chunk_seconds);
+
+  //true if the samples are clearly silence and the vad can be skipped
+  bool is_silence(const float* samples, size_t count);
+
+  //the vad found no speech in the samples last passed on, so the noise floor can follow a louder background
+  void no_speech();
+
+  uint64_t gated() const {
+    return _gated.load();
+  }
+
+  uint64_t evaluated() const {
+    return _evaluated.load();
+  }
+
+private:
+  bool _enabled;
+  float _margin;
+  float _silence_rms;
+  float _zcr_delta;
+
+  float _noise_rise;
+
+  //background level, only learnt from gated audio or audio the vad confirmed has no speech
+  float _noise_rms;
+  float _noise_zcr;
+
+  float _last_rms;
+  float _last_zcr;
+
+  std::atomic<uint64_t> _gated;
+  std::atomic<uint64_t> _evaluated;
+
+  void learn_noise(float rms, float zcr);
+};
+
+#endif
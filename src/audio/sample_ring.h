@@ -0,0 +1,99 @@
+#ifndef __SAMPLE_RING_H__
+#define __SAMPLE_RING_H__
+
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+//single producer / single consumer ring of audio samples
+//storage is allocated once and neither side locks, so the producer can be a real time audio callback
+class sample_ring {
+public:
+  //capacity is rounded up to a power of two
+  sample_ring(size_t capacity) {
+    size_t size = 1;
+    while(size < capacity) {
+      size <<= 1;
+    }
+    _samples.resize(size);
+    _mask = size - 1;
+    _write.store(0);
+    _read.store(0);
+    _overruns.store(0);
+    _dropped.store(0);
+  }
+
+  //producer: copy a block of samples in, a block that doesn't fit is dropped whole (and counted as an overrun)
+  bool write(const float* in, size_t count) {
+    const size_t w = _write.load(std::memory_order_relaxed);
+    const size_t r = _read.load(std::memory_order_acquire);
+    if(count > _samples.size() - (w - r)) {
+      _overruns.fetch_add(1, std::memory_order_relaxed);
+      _dropped.fetch_add(count, std::memory_order_relaxed);
+      return false;
+    }
+
+    copy_in(w & _mask, in, count);
+    _write.store(w + count, std::memory_order_release);
+    return true;
+  }
+
+  //consumer: copy up to count samples out, returns the number copied
+  size_t read(float* out, size_t count) {
+    const size_t r = _read.load(std::memory_order_relaxed);
+    const size_t w = _write.load(std::memory_order_acquire);
+    if(count > w - r) {
+      count = w - r;
+    }
+
+    copy_out(r & _mask, out, count);
+    _read.store(r + count, std::memory_order_release);
+    return count;
+  }
+
+  //consumer: discard everything currently queued
+  void clear() {
+    _read.store(_write.load(std::memory_order_acquire), std::memory_order_release);
+  }
+
+  //samples queued for the consumer
+  size_t available() const {
+    return _write.load(std::memory_order_acquire) - _read.load(std::memory_order_relaxed);
+  }
+
+  //blocks dropped because the consumer fell behind, and the samples they held
+  uint64_t overruns() const {
+    return _overruns.load(std::memory_order_relaxed);
+  }
+
+  uint64_t dropped() const {
+    return _dropped.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::vector<float> _samples;
+  size_t _mask;
+
+  //free running sample counts, only ever wrapped through _mask
+  std::atomic<size_t> _write;
+  std::atomic<size_t> _read;
+
+  std::atomic<uint64_t> _overruns;
+  std::atomic<uint64_t> _dropped;
+
+  void copy_in(size_t pos, const float* in, size_t count) {
+    size_t first = std::min(count, _samples.size() - pos);
+    std::memcpy(&_samples[pos], in, first * sizeof(float));
+    std::memcpy(&_samples[0], in + first, (count - first) * sizeof(float));
+  }
+
+  void copy_out(size_t pos, float* out, size_t count) const {
+    size_t first = std::min(count, _samples.size() - pos);
+    std::memcpy(out, &_samples[pos], first * sizeof(float));
+    std::memcpy(out + first, &_samples[0], (count - first) * sizeof(float));
+  }
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include "streaming_vad.h"
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+//silero vad window at 16kHz, the granularity of speech probabilities
+const size_t vad_window = 512;
+
+//speech probability has to drop this far below the threshold to count as silence
+const float vad_end_margin = 0.15f;
+
+static size_t ms_to_windows(int ms, uint32_t samples_per_second) {
+  size_t windows = (size_t(ms) * samples_per_second / 1000 + vad_window / 2) / vad_window;
+  return std::max<size_t>(windows, 1);
+}
+
+streaming_vad::streaming_vad(YAML::Node config, whisper_wrapper& w, uint32_t samples_per_second) : _whisp(w) {
+  _threshold = config["vadStreamThreshold"].as<float>();
+  _end_threshold = std::max(_threshold - vad_end_margin, 0.0f);
+
+  _hop_samples = ms_to_windows(config["vadHopMs"].as<int>(), samples_per_second) * vad_window;
+  _context_samples = ms_to_windows(config["vadContextMs"].as<int>(), samples_per_second) * vad_window;
+  _min_speech_windows = ms_to_windows(config["vadMinSpeechMs"].as<int>(), samples_per_second);
+  _hangover_windows = ms_to_windows(config["vadHangoverMs"].as<int>(), samples_per_second);
+
+  _audio.reserve(_context_samples + _hop_samples);
+  reset();
+}
+
+void streaming_vad::reset() {
+  _audio.clear();
+  _in_speech = false;
+  _speech_run = 0;
+  _silence_run = 0;
+}
+
+size_t streaming_vad::window_samples() {
+  return vad_window;
+}
+
+int streaming_vad::process(const std::vector<float>& hop, std::vector<int>& events) {
+  //the whisper vad api restarts the model's recurrent state on every call,
+  //so it is rebuilt by running the preceding context through again before the new hop
+  size_t context = _audio.size();
+  _audio.insert(_audio.end(), hop.begin(), hop.end());
+
+  if(_whisp.speech_probs(_audio, _probs)) {
+    keep_context();
+    return -1;
+  }
+
+  size_t first = std::min(context / vad_window, _probs.size());
+  advance(_probs.data() + first, _probs.size() - first, events);
+  keep_context();
+  return 0;
+}
+
+int streaming_vad::silence(const std::vector<float>& hop, std::vector<int>& events) {
+  //the hop still becomes context, so the model sees continuous audio when it next runs
+  _audio.insert(_audio.end(), hop.begin(), hop.end());
+  _probs.assign(hop.size() / vad_window, 0.0f);
+  advance(_probs.data(), _probs.size(), events);
+  keep_context();
+  return 0;
+}
+
+void streaming_vad::advance(const float* probs, size_t count, std::vector<int>& events) {
+  events.assign(count, vad_none);
+  for(size_t i = 0; i < count; i++) {
+    if(!_in_speech) {
+      _speech_run = probs[i] >= _threshold ? _speech_run + 1 : 0;
+      if(_speech_run >= _min_speech_windows) {
+        _in_speech = true;
+        _silence_run = 0;
+        events[i] = vad_speech_start;
+      }
+    } else {
+      _silence_run = probs[i] < _end_threshold ? _silence_run + 1 : 0;
+      if(_silence_run >= _hangover_windows) {
+        _in_speech = false;
+        _speech_run = 0;
+        events[i] = vad_speech_end;
+      }
+    }
+  }
+}
+
+void streaming_vad::keep_context() {
+  //keep the tail as context for the next hop
+  if(_audio.size() > _context_samples) {
+    _audio.erase(_audio.begin(), _audio.end() - _context_samples);
+  }
+}
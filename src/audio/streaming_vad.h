@@ -0,0 +1,66 @@
+#ifndef __STREAMING_VAD_H__
+#define __STREAMING_VAD_H__
+
+#include <vector>
+#include <yaml-cpp/yaml.h>
+
+#include "whisper_wrapper.h"
+
+enum vad_event {
+  vad_none = 0,
+  vad_speech_start,
+  vad_speech_end
+};
+
+//frame level voice activity detection on short hops of audio as they arrive
+//speech starts after vadMinSpeechMs of speech windows and ends after vadHangoverMs of silence windows
+class streaming_vad {
+public:
+  streaming_vad(YAML::Node config, whisper_wrapper& w, uint32_t samples_per_second);
+
+  //feed the next hop of audio, fills events with the vad_event of each vad window in it, returns < 0 on failure
+  //a hop can both start and end speech, so the caller has to walk the windows in order
+  int process(const std::vector<float>& hop, std::vector<int>& events);
+
+  //feed the next hop of audio already known to be silence, without running the model
+  int silence(const std::vector<float>& hop, std::vector<int>& events);
+
+  //forget all audio and state, e.g. after dropping queued audio
+  void reset();
+
+  //samples expected per call to process (a whole number of vad windows)
+  size_t hop_samples() const {
+    return _hop_samples;
+  }
+
+  //samples each entry of events covers
+  static size_t window_samples();
+
+  bool in_speech() const {
+    return _in_speech;
+  }
+
+private:
+  whisper_wrapper& _whisp;
+
+  float _threshold;
+  float _end_threshold;
+
+  size_t _hop_samples;
+  size_t _context_samples;
+  int _min_speech_windows;
+  int _hangover_windows;
+
+  //previous audio the model is warmed up on, followed by the current hop
+  std::vector<float> _audio;
+  std::vector<float> _probs;
+
+  bool _in_speech;
+  int _speech_run;
+  int _silence_run;
+
+  void advance(const float* probs, size_t count, std::vector<int>& events);
+  void keep_context();
+};
+
+#endif
@@ -2,6 +2,9 @@
 
 #include <iostream>
 #include <thread>
+#include <chrono>
+#include <sstream>
+#include <algorithm>
 #include <spdlog/spdlog.h>
 
 const int    vad_min_speech_duration_ms = 250;
@@ -13,6 +16,13 @@ const float  vad_samples_overlap = 0.1f;
 const int32_t audio_ctx = 0;
 const int32_t beam_size = 5;
 
+//whisper encodes 50 audio frames a second (1500 for its full 30s), a fitted context covers the audio plus some margin
+const int32_t ctx_per_second = 50;
+const int32_t ctx_margin = 32;
+const int32_t ctx_full = 1500;
+
+const int32_t spot_max_tokens = 8;
+
 void cb_log(enum ggml_log_level level, const char * str, void * arg) {
   if(level == 3) {
     spdlog::warn(" [whisper] {}", str);
@@ -31,6 +41,27 @@ whisper_wrapper::whisper_wrapper(YAML::Node config) {
 
   _max_threads = config["maxThreads"].as<int>();
 
+  _default_profile = {"default", utterance_any, 30.0f, beam_size, false};
+  for(const auto& node: config["decodeProfiles"]) {
+    decode_profile profile;
+    profile.name = node["name"].as<std::string>();
+    std::string kind = node["kind"].as<std::string>();
+    if(kind == "command") {
+      profile.kind = utterance_command;
+    } else if(kind == "ai") {
+      profile.kind = utterance_ai;
+    } else {
+      if(kind != "any") {
+        spdlog::warn("unknown kind \"{}\" in whisper decode profile {}, using it for any utterance", kind, profile.name);
+      }
+      profile.kind = utterance_any;
+    }
+    profile.max_seconds = node["maxSeconds"].as<float>();
+    profile.beam_size = node["beamSize"].as<int>();
+    profile.fit_audio_ctx = node["fitAudioCtx"].as<bool>();
+    _profiles.push_back(profile);
+  }
+
   ggml_backend_load_all();
   whisper_log_set(cb_log, NULL);
 
@@ -86,10 +117,66 @@ int whisper_wrapper::contains_speech(std::vector<float>& audioin) {
   return ret;
 }
 
-int whisper_wrapper::convert_audio_to_text(std::vector<float>& audio, size_t samples_to_process, std::string& text) {
+int whisper_wrapper::speech_probs(std::vector<float>& audioin, std::vector<float>& probs) {
+  if (!whisper_vad_detect_speech(_vctx, audioin.data(), audioin.size())) {
+    spdlog::error("failed to detect speech");
+    return -1;
+  }
+
+  const float* p = whisper_vad_probs(_vctx);
+  probs.assign(p, p + whisper_vad_n_probs(_vctx));
+  return 0;
+}
+
+int32_t whisper_wrapper::fitted_audio_ctx(size_t samples) {
+  return std::min<int32_t>(samples * ctx_per_second / WHISPER_SAMPLE_RATE + ctx_margin, ctx_full);
+}
+
+int whisper_wrapper::convert_audio_to_text(std::vector<float>& audio, size_t samples_to_process, std::string& text,
+                                           utterance_kind kind) {
   //perform local speech to text conversion
 
-  whisper_full_params wparams = whisper_full_default_params(beam_size > 1 ? WHISPER_SAMPLING_BEAM_SEARCH : WHISPER_SAMPLING_GREEDY);
+  //first profile for this kind of utterance that is long enough, otherwise full context beam search
+  const float seconds = float(samples_to_process) / WHISPER_SAMPLE_RATE;
+  for(const auto& profile: _profiles) {
+    if((profile.kind == utterance_any || profile.kind == kind) && seconds <= profile.max_seconds) {
+      return transcribe(audio, samples_to_process, text, profile);
+    }
+  }
+  return transcribe(audio, samples_to_process, text, _default_profile);
+}
+
+int whisper_wrapper::convert_audio_to_text(std::vector<float>& audio, size_t samples_to_process, std::string& text,
+                                           const std::string& profile_name) {
+  for(const auto& profile: _profiles) {
+    if(profile.name == profile_name) {
+      return transcribe(audio, samples_to_process, text, profile);
+    }
+  }
+  if(profile_name != _default_profile.name) {
+    spdlog::error("no whisper decode profile named {}", profile_name);
+    return -1;
+  }
+  return transcribe(audio, samples_to_process, text, _default_profile);
+}
+
+std::vector<std::string> whisper_wrapper::profile_names() const {
+  std::vector<std::string> names = {_default_profile.name};
+  for(const auto& profile: _profiles) {
+    names.push_back(profile.name);
+  }
+  return names;
+}
+
+int whisper_wrapper::transcribe(std::vector<float>& audio, size_t samples_to_process, std::string& text,
+                                const decode_profile& profile) {
+  const float seconds = float(samples_to_process) / WHISPER_SAMPLE_RATE;
+  const int32_t beams = profile.beam_size;
+  const int32_t ctx = profile.fit_audio_ctx ? fitted_audio_ctx(samples_to_process) : audio_ctx;
+
+  auto start = std::chrono::steady_clock::now();
+
+  whisper_full_params wparams = whisper_full_default_params(beams > 1 ? WHISPER_SAMPLING_BEAM_SEARCH : WHISPER_SAMPLING_GREEDY);
 
   wparams.print_progress   = false;
   wparams.print_special    = false;
@@ -100,8 +187,8 @@ int whisper_wrapper::convert_audio_to_text(std::vector<float>& audio, size_t sam
   wparams.max_tokens       = 100;
   wparams.language         = "en";
   wparams.n_threads        = std::min(_max_threads, (int32_t) std::thread::hardware_concurrency());
-  wparams.beam_search.beam_size = beam_size;
-  wparams.audio_ctx        = audio_ctx;
+  wparams.beam_search.beam_size = beams;
+  wparams.audio_ctx        = ctx;
   wparams.tdrz_enable      = false; // [TDRZ]
   // disable temperature fallback
   //wparams.temperature_inc  = -1.0f;
@@ -124,6 +211,38 @@ int whisper_wrapper::convert_audio_to_text(std::vector<float>& audio, size_t sam
   }
   text = ss.str();
 
+  spdlog::info("Transcribed {:.1f} s of speech in {} ms ({} profile)", seconds,
+               std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count(), profile.name);
+
+  return 0;
+}
+
+int whisper_wrapper::spot_text(const float* audio, size_t samples_to_process, std::string& text) {
+  whisper_full_params wparams = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+
+  wparams.print_progress   = false;
+  wparams.print_special    = false;
+  wparams.print_realtime   = false;
+  wparams.print_timestamps = false;
+  wparams.translate        = false;
+  wparams.single_segment   = true;
+  wparams.no_timestamps    = true;
+  wparams.max_tokens       = spot_max_tokens;
+  wparams.language         = "en";
+  wparams.n_threads        = std::min(_max_threads, (int32_t) std::thread::hardware_concurrency());
+  wparams.audio_ctx        = fitted_audio_ctx(samples_to_process);
+  wparams.temperature_inc  = 0.0f;
+
+  if (whisper_full(_ctx, wparams, audio, samples_to_process) != 0) {
+    spdlog::error("failed to whisper process audio");
+    return -1;
+  }
+
+  text.clear();
+  const int n_segments = whisper_full_n_segments(_ctx);
+  for (int i = 0; i < n_segments; ++i) {
+    text += whisper_full_get_segment_text(_ctx, i);
+  }
 
   return 0;
 }
@@ -6,6 +6,13 @@
 #include <whisper.h>
 #include <vector>
 
+//what an utterance was spotted as, decoding profiles can be chosen by it
+enum utterance_kind {
+  utterance_any = 0,
+  utterance_command,
+  utterance_ai
+};
+
 class whisper_wrapper {
 public:
   whisper_wrapper(YAML::Node config);
@@ -14,7 +21,23 @@ public:
 
   int contains_speech(std::vector<float>& audio);
 
-  int convert_audio_to_text(std::vector<float>& audio, size_t samples_to_process, std::string& text);
+  //speech probability of each vad window of audio
+  int speech_probs(std::vector<float>& audio, std::vector<float>& probs);
+
+  //transcribe with the first decoding profile matching the utterance kind and length
+  int convert_audio_to_text(std::vector<float>& audio, size_t samples_to_process, std::string& text,
+                            utterance_kind kind = utterance_any);
+
+  //transcribe with the named decoding profile whatever the utterance ("default" is full context beam search)
+  int convert_audio_to_text(std::vector<float>& audio, size_t samples_to_process, std::string& text,
+                            const std::string& profile_name);
+
+  //the default profile followed by the configured ones, in the order they are tried
+  std::vector<std::string> profile_names() const;
+
+  //quick greedy transcription of a short stretch of audio with a reduced encoder context
+  //no prompt, so the activation words aren't suggested to the decoder on audio that doesn't contain them
+  int spot_text(const float* audio, size_t samples_to_process, std::string& text);
 
 private:
   std::string _vad_model;
@@ -24,6 +47,21 @@ private:
 
   int _max_threads;
 
+  struct decode_profile {
+    std::string name;
+    utterance_kind kind;
+    float max_seconds;
+    int beam_size;
+    //encode only as much context as the audio needs instead of the full 30s
+    bool fit_audio_ctx;
+  };
+  std::vector<decode_profile> _profiles;
+  decode_profile _default_profile;
+
+  static int32_t fitted_audio_ctx(size_t samples);
+
+  int transcribe(std::vector<float>& audio, size_t samples_to_process, std::string& text, const decode_profile& profile);
+
   struct whisper_vad_context * _vctx;
   struct whisper_context *_ctx;
 
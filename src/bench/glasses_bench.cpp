@@ -0,0 +1,242 @@
+//headless benchmark of the image pipeline processing
+//replays a recorded video (or image sequence) through the same zoom and mode processing as the image thread,
+//sweeping the modes and zoom levels, and prints throughput and latency percentiles as json
+
+#include "../config/config.h"
+#include "../imaging/image_processor.h"
+#include "../imaging/display_size.h"
+#include "../imaging/pipeline_stats.h"
+
+#include <yaml-cpp/yaml.h>
+#include <spdlog/spdlog.h>
+#include <nlohmann/json.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <vector>
+
+//frames processed before timing starts (remap tables and buffers are set up on the first frames)
+const int warmup_frames = 5;
+const int default_frames = 120;
+
+const int max_zoom = 9;
+
+//imageedgeno values swept in edge mode
+const int edgeno_sweep[] = {10, 25, 50, 100, 150, 200};
+
+//the processing as it was before the pipeline rework (crop + resize, whole frame edge/contrast with temporaries)
+//kept as the reference the current path is compared against
+static void legacy_process(const cv::Mat& captured, cv::Mat& img, cv::Size output, const cv::Rect2f& region,
+                           const processing_settings& s) {
+  cv::Rect crop(cvRound(region.x * captured.cols), cvRound(region.y * captured.rows),
+                cvRound(region.width * captured.cols), cvRound(region.height * captured.rows));
+  cv::resize(captured(crop & cv::Rect(0, 0, captured.cols, captured.rows)), img, output);
+
+  if (s.mode == 2) {
+    cv::Mat img_gray;
+    cv::cvtColor(img, img_gray, cv::COLOR_BGR2GRAY);
+    cv::Mat img_blur;
+    cv::GaussianBlur(img_gray, img_blur, cv::Size(7, 7), 0);
+    cv::Mat edges;
+    cv::Canny(img_blur, edges, s.edgeno, s.edgeno, 3, false);
+    cv::Mat wide_edges;
+    cv::dilate(edges, wide_edges, cv::Mat(), cv::Point(-1 ,-1), 2, 1, 1);
+    cv::Mat col_edges;
+    cv::cvtColor(wide_edges, col_edges, cv::COLOR_GRAY2BGR);
+    col_edges.setTo(cv::Scalar(0, 255, 255),col_edges);
+    img = img + col_edges;
+  }
+
+  if (s.mode == 3) {
+    cv::Mat img_gray;
+    cv::cvtColor(img, img_gray, cv::COLOR_BGR2GRAY);
+    cv::threshold(img_gray, img, s.thresh_lev, 255, s.threshmode);
+    cv::cvtColor(img, img, cv::COLOR_GRAY2BGR);
+    img.setTo(cv::Scalar(0, 255, 255),img);
+  }
+}
+
+struct bench_result {
+  double fps;
+  duration_histogram::counts latency;
+  //share of edge strips reused by the motion gate instead of recomputed
+  double edge_reuse;
+};
+
+//run every frame through the current pipeline processing with the given settings
+static bench_result run_current(image_processor& processor, const std::vector<frame>& frames, const processing_settings& s) {
+  duration_histogram hist;
+  frame in;
+  frame out;
+  std::chrono::steady_clock::duration total(0);
+
+  const int formats = image_processor::wanted_formats(s.mode);
+  for(int i = -warmup_frames; i < (int)frames.size(); i++) {
+    //the camera writes into recycled buffers, copied outside the timing
+    const frame& src = frames[(i + frames.size()) % frames.size()];
+    if(formats & frame_bgr) {
+      src.image.copyTo(in.image);
+    }
+    if(formats & frame_luma) {
+      src.luma.copyTo(in.luma);
+    }
+    in.formats = formats;
+    in.seq = i;
+
+    auto start = std::chrono::steady_clock::now();
+    processor.zoom(in, out, s.zoom);
+    processor.process(out, s);
+    auto d = std::chrono::steady_clock::now() - start;
+
+    if(i >= 0) {
+      hist.record(d);
+      total += d;
+    } else if(i == -1) {
+      //reuse is only counted over the timed frames
+      processor.take_reuse_ratio();
+    }
+  }
+
+  return {frames.size() / std::chrono::duration<double>(total).count(), hist.read(), processor.take_reuse_ratio()};
+}
+
+static bench_result run_legacy(image_processor& processor, const std::vector<frame>& frames, cv::Size output,
+                               const processing_settings& s) {
+  duration_histogram hist;
+  cv::Mat img;
+  std::chrono::steady_clock::duration total(0);
+
+  for(int i = -warmup_frames; i < (int)frames.size(); i++) {
+    const frame& src = frames[(i + frames.size()) % frames.size()];
+
+    auto start = std::chrono::steady_clock::now();
+    legacy_process(src.image, img, output, processor.region(s.zoom), s);
+    auto d = std::chrono::steady_clock::now() - start;
+
+    if(i >= 0) {
+      hist.record(d);
+      total += d;
+    }
+  }
+
+  return {frames.size() / std::chrono::duration<double>(total).count(), hist.read(), 0.0};
+}
+
+static nlohmann::json to_json(const bench_result& r, const processing_settings& s, const char* path) {
+  return {
+    {"path", path},
+    {"mode", s.mode},
+    {"zoom", s.zoom},
+    {"edgeno", s.edgeno},
+    {"fps", r.fps},
+    {"edge_reuse", r.edge_reuse},
+    {"p50_ms", r.latency.percentile(0.5)},
+    {"p95_ms", r.latency.percentile(0.95)},
+    {"p99_ms", r.latency.percentile(0.99)}
+  };
+}
+
+int main(int argc, char *argv[]) {
+  config::config args;
+  args.add_option('c', "config", "yaml config file (Imaging settings)");
+  args.add_option('i', "input", "recorded video file or image sequence (e.g. frames/%04d.png)");
+  args.add_option('n', "frames", "number of frames to load from the input (default 120)", true);
+  args.add_option('o', "output", "file to write the json results to (default stdout)", true);
+  args.add_flag('l', "legacy", "also run the pre-rework processing for comparison");
+  args.add_flag('e', "edges", "sweep imageedgeno in edge mode");
+  args.add_flag('m', "motion", "reuse edges of unchanged strips with the configured motionthreshold (off by default, so current and legacy both compute every frame)");
+  if(args.parse_args(argc, argv, VIG_VERSION)) return EXIT_SUCCESS;
+
+  spdlog::set_level(spdlog::level::warn);
+
+  YAML::Node config;
+  try {
+    config = YAML::LoadFile(args.get_value<std::string>("config"));
+  } catch (...) {
+    std::cerr << "ERROR: failed to read yaml config file" << std::endl;
+    return EXIT_FAILURE;
+  }
+  YAML::Node imaging = config["Imaging"];
+
+  int max_frames = args.get_value<std::string>("frames").empty() ? default_frames : args.get_value<int>("frames");
+
+  //decode everything up front so decoding isn't part of the timing
+  //luma is provided alongside, as the native v4l2 formats do
+  std::string input = args.get_value<std::string>("input");
+  cv::VideoCapture capture(input);
+  std::vector<frame> frames;
+  cv::Mat img;
+  while((int)frames.size() < max_frames && capture.read(img) && !img.empty()) {
+    frame f;
+    f.image = img.clone();
+    cv::cvtColor(f.image, f.luma, cv::COLOR_BGR2GRAY);
+    f.formats = frame_bgr | frame_luma;
+    frames.push_back(f);
+  }
+  if(frames.empty()) {
+    std::cerr << "ERROR: no frames could be read from " << input << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  //sizes as the image thread derives them, without a display attached only the configured size is used
+  cv::Size capture_size = frames[0].image.size();
+  cv::Size output = output_size(cv::Size(imaging["displaywidth"].as<int>(), imaging["displayheight"].as<int>()), capture_size);
+
+  //on a looping clip the motion gate would reuse edges the legacy path recomputes, so it is only on when asked for
+  int motion_threshold = args.get_flag("motion") ? imaging["motionthreshold"].as<int>() : 0;
+  image_processor processor(motion_threshold);
+  processor.set_output(output);
+
+  processing_settings s;
+  s.edgeno = imaging["imageedgeno"].as<int>();
+  s.thresh_lev = imaging["imagethresh-lev"].as<int>();
+  s.threshmode = imaging["imagethreshmode"].as<int>();
+  s.scale = imaging["processingscale"].as<int>();
+
+  nlohmann::json results;
+  results["input"] = input;
+  results["frames"] = frames.size();
+  results["capture_size"] = {capture_size.width, capture_size.height};
+  results["output_size"] = {output.width, output.height};
+  results["processing_scale"] = s.scale;
+  results["motion_threshold"] = motion_threshold;
+  results["threads"] = cv::getNumThreads();
+  results["results"] = nlohmann::json::array();
+
+  for(s.mode = 1; s.mode <= 3; s.mode++) {
+    for(s.zoom = 0; s.zoom <= max_zoom; s.zoom++) {
+      results["results"].push_back(to_json(run_current(processor, frames, s), s, "current"));
+      if(args.get_flag("legacy")) {
+        results["results"].push_back(to_json(run_legacy(processor, frames, output, s), s, "legacy"));
+      }
+    }
+  }
+
+  if(args.get_flag("edges")) {
+    results["edgeno_sweep"] = nlohmann::json::array();
+    s.mode = 2;
+    s.zoom = 0;
+    for(int edgeno: edgeno_sweep) {
+      s.edgeno = edgeno;
+      results["edgeno_sweep"].push_back(to_json(run_current(processor, frames, s), s, "current"));
+      if(args.get_flag("legacy")) {
+        results["edgeno_sweep"].push_back(to_json(run_legacy(processor, frames, output, s), s, "legacy"));
+      }
+    }
+  }
+
+  std::string output_file = args.get_value<std::string>("output");
+  if(output_file.empty()) {
+    std::cout << results.dump(2) << std::endl;
+  } else {
+    std::ofstream f(output_file);
+    if(!f) {
+      std::cerr << "ERROR: failed to write results to " << output_file << std::endl;
+      return EXIT_FAILURE;
+    }
+    f << results.dump(2) << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+//check of the energy gate in front of the vad on a synthetic corpus
+//alternates background noise with voiced (harmonic) and fricative (noise like) speech over it, at a range of
+//noise floors and signal to noise ratios, for both the chunk mode and the stream mode chunk sizes
+//then fades speech in slowly after a long stretch of background, so soft speech the gate lets through as silence
+//mustn't raise its noise floor enough to gate the speech once it is loud enough to tell apart
+//prints how many chunks were gated against evaluated as json, and fails if any speech chunk was gated
+
+#include "../config/config.h"
+#include "../audio/energy_gate.h"
+
+#include <yaml-cpp/yaml.h>
+#include <nlohmann/json.hpp>
+
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cmath>
+
+//background noise rms, from -60 dBFS up to a loud room
+const float noise_levels[] = {0.001f, 0.003f, 0.01f, 0.03f};
+//speech has to lift the level past gateMargin (1.5 = 3.5 dB) to be passed on, so fricatives at 0 dB snr
+//(white noise as loud as the background, +3 dB overall) are below what the gate can tell apart and aren't checked
+const float snr_db[] = {6.0f, 12.0f, 20.0f};
+
+//chunks per condition, in runs of run_chunks: two runs of background then one run of speech
+const int corpus_chunks = 200;
+const int run_chunks = 10;
+
+//voiced speech as a fundamental and one harmonic
+const float voiced_hz = 150.0f;
+const float harmonic_hz = 450.0f;
+
+//onset case: background before the speech, the fade in from silence to onset_snr_db, then speech held at it
+const float onset_background_seconds = 10.0f;
+const float onset_ramp_seconds = 10.0f;
+const float onset_hold_seconds = 3.0f;
+const float onset_snr_db = 6.0f;
+
+//fixed seed so a failure can be reproduced
+const unsigned corpus_seed = 1;
+
+struct check_result {
+  int speech = 0;
+  int speech_gated = 0;
+  int background = 0;
+  int background_gated = 0;
+  uint64_t gated = 0;
+  uint64_t evaluated = 0;
+};
+
+//one chunk of background noise with speech of rms amp over it, t is the running sample count
+static void make_chunk(std::vector<float>& chunk, size_t& t, uint32_t rate, float noise, float amp, bool fricative,
+                       std::mt19937& rng) {
+  std::normal_distribution<float> unit(0.0f, 1.0f);
+  //the sines are scaled up to the same rms as the fricative noise
+  const float sine_amp = amp * std::sqrt(2.0f / 1.25f);
+  for(size_t i = 0; i < chunk.size(); i++, t++) {
+    float s = fricative ? amp * unit(rng) :
+              sine_amp * (std::sin(2 * M_PI * voiced_hz * t / rate) + 0.5f * std::sin(2 * M_PI * harmonic_hz * t / rate));
+    chunk[i] = s + noise * unit(rng);
+  }
+}
+
+//run one chunk through the gate, speech that can be told apart from the background must not be gated
+static void check_chunk(energy_gate& gate, std::vector<float>& chunk, bool speech, bool must_pass, check_result& r) {
+  bool gated = gate.is_silence(chunk.data(), chunk.size());
+  if(speech) {
+    if(must_pass) {
+      r.speech++;
+      r.speech_gated += gated;
+    }
+  } else {
+    r.background++;
+    r.background_gated += gated;
+  }
+  if(!gated && !speech) {
+    //as the vad would report
+    gate.no_speech();
+  }
+}
+
+static check_result run_condition(const YAML::Node& audio, size_t chunk_samples, uint32_t rate,
+                                  float noise, float snr, std::mt19937& rng) {
+  check_result r;
+  energy_gate gate(audio, float(chunk_samples) / rate);
+
+  //speech rms matches the noise rms scaled by the snr
+  const float amp = noise * std::pow(10.0f, snr / 20.0f);
+
+  std::vector<float> chunk(chunk_samples);
+  size_t t = 0;
+  for(int k = 0; k < corpus_chunks; k++) {
+    bool speech = (k / run_chunks) % 3 == 2;
+    make_chunk(chunk, t, rate, noise, speech ? amp : 0.0f, k % 2, rng);
+    check_chunk(gate, chunk, speech, true, r);
+  }
+
+  r.gated = gate.gated();
+  r.evaluated = gate.evaluated();
+  return r;
+}
+
+//speech fading in after a long stretch of background, only the held speech at the end has to pass
+static check_result run_onset(const YAML::Node& audio, size_t chunk_samples, uint32_t rate, float noise,
+                              std::mt19937& rng) {
+  check_result r;
+  energy_gate gate(audio, float(chunk_samples) / rate);
+
+  const float chunk_seconds = float(chunk_samples) / rate;
+  const int background = std::ceil(onset_background_seconds / chunk_seconds);
+  const int ramp = std::ceil(onset_ramp_seconds / chunk_seconds);
+  const int hold = std::ceil(onset_hold_seconds / chunk_seconds);
+  const float amp = noise * std::pow(10.0f, onset_snr_db / 20.0f);
+
+  std::vector<float> chunk(chunk_samples);
+  size_t t = 0;
+  for(int k = 0; k < background + ramp + hold; k++) {
+    bool speech = k >= background;
+    float level = std::min(float(k - background + 1) / ramp, 1.0f);
+    make_chunk(chunk, t, rate, noise, speech ? amp * level : 0.0f, k % 2, rng);
+    check_chunk(gate, chunk, speech, k >= background + ramp, r);
+  }
+
+  r.gated = gate.gated();
+  r.evaluated = gate.evaluated();
+  return r;
+}
+
+int main(int argc, char *argv[]) {
+  config::config args;
+  args.add_option('c', "config", "yaml config file (audio gate settings)");
+  if(args.parse_args(argc, argv, VIG_VERSION)) return EXIT_SUCCESS;
+
+  YAML::Node audio;
+  try {
+    audio = YAML::LoadFile(args.get_value<std::string>("config"))["audio"];
+  } catch (...) {
+    std::cerr << "ERROR: failed to read yaml config file" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  //the check is of the gate itself, whatever the config has it set to
+  audio["vadGate"] = true;
+
+  uint32_t rate = audio["samplesPerSec"].as<uint32_t>();
+  size_t chunk_sizes[] = {audio["samplesPerCheck"].as<size_t>(), size_t(audio["vadHopMs"].as<int>()) * rate / 1000};
+
+  std::mt19937 rng(corpus_seed);
+  nlohmann::json results;
+  results["results"] = nlohmann::json::array();
+  results["onset"] = nlohmann::json::array();
+  int speech = 0, speech_gated = 0;
+  uint64_t gated = 0, evaluated = 0;
+
+  for(size_t chunk_samples: chunk_sizes) {
+    for(float noise: noise_levels) {
+      for(float snr: snr_db) {
+        check_result r = run_condition(audio, chunk_samples, rate, noise, snr, rng);
+        results["results"].push_back({
+          {"chunk_samples", chunk_samples},
+          {"noise_rms", noise},
+          {"snr_db", snr},
+          {"speech_chunks", r.speech},
+          {"speech_gated", r.speech_gated},
+          {"background_chunks", r.background},
+          {"background_gated", r.background_gated}
+        });
+        speech += r.speech;
+        speech_gated += r.speech_gated;
+        gated += r.gated;
+        evaluated += r.evaluated;
+      }
+
+      check_result r = run_onset(audio, chunk_samples, rate, noise, rng);
+      results["onset"].push_back({
+        {"chunk_samples", chunk_samples},
+        {"noise_rms", noise},
+        {"snr_db", onset_snr_db},
+        {"speech_chunks", r.speech},
+        {"speech_gated", r.speech_gated},
+        {"background_chunks", r.background},
+        {"background_gated", r.background_gated}
+      });
+      speech += r.speech;
+      speech_gated += r.speech_gated;
+      gated += r.gated;
+      evaluated += r.evaluated;
+    }
+  }
+
+  results["speech_chunks"] = speech;
+  results["speech_gated"] = speech_gated;
+  results["gated"] = gated;
+  results["evaluated"] = evaluated;
+  results["gated_ratio"] = double(gated) / (gated + evaluated);
+  std::cout << results.dump(2) << std::endl;
+
+  if(speech_gated) {
+    std::cerr << "ERROR: " << speech_gated << " of " << speech << " speech chunks were gated as silence" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,232 @@
+//benchmark of the whisper decoding profiles
+//transcribes a directory of recorded utterances (foo.wav with its reference transcript in foo.txt) with the
+//default full context beam search and with each configured decoding profile, and prints the decode time and
+//word error rate of each as json
+
+#include "../config/config.h"
+#include "../audio/whisper_wrapper.h"
+
+#include <yaml-cpp/yaml.h>
+#include <spdlog/spdlog.h>
+#include <nlohmann/json.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+struct utterance {
+  std::string name;
+  std::vector<float> audio;
+  std::vector<std::string> reference;
+};
+
+//lowercase words with the punctuation whisper adds stripped, so only the words themselves are compared
+static std::vector<std::string> words(const std::string& text) {
+  std::vector<std::string> out;
+  std::string word;
+  std::istringstream ss(text);
+  while(ss >> word) {
+    std::string clean;
+    for(unsigned char c: word) {
+      if(std::isalnum(c) || c == '\'') {
+        clean += std::tolower(c);
+      }
+    }
+    if(!clean.empty()) {
+      out.push_back(clean);
+    }
+  }
+  return out;
+}
+
+//word level edit distance (substitutions, deletions and insertions)
+static size_t word_errors(const std::vector<std::string>& ref, const std::vector<std::string>& hyp) {
+  std::vector<size_t> prev(hyp.size() + 1), cur(hyp.size() + 1);
+  for(size_t j = 0; j <= hyp.size(); j++) {
+    prev[j] = j;
+  }
+  for(size_t i = 1; i <= ref.size(); i++) {
+    cur[0] = i;
+    for(size_t j = 1; j <= hyp.size(); j++) {
+      cur[j] = std::min({prev[j] + 1, cur[j - 1] + 1, prev[j - 1] + (ref[i - 1] != hyp[j - 1])});
+    }
+    prev.swap(cur);
+  }
+  return prev[hyp.size()];
+}
+
+//16 bit pcm or 32 bit float wav at whisper's sample rate, channels are mixed down to mono
+static bool read_wav(const std::string& path, std::vector<float>& audio) {
+  std::ifstream f(path, std::ios::binary);
+  char riff[12];
+  if(!f.read(riff, sizeof(riff)) || std::memcmp(riff, "RIFF", 4) || std::memcmp(riff + 8, "WAVE", 4)) {
+    return false;
+  }
+
+  uint16_t format = 0, channels = 0, bits = 0;
+  uint32_t rate = 0;
+  char id[4];
+  uint32_t size;
+  while(f.read(id, 4) && f.read((char*)&size, 4)) {
+    if(!std::memcmp(id, "fmt ", 4)) {
+      std::vector<char> fmt(size);
+      f.read(fmt.data(), size);
+      std::memcpy(&format, &fmt[0], 2);
+      std::memcpy(&channels, &fmt[2], 2);
+      std::memcpy(&rate, &fmt[4], 4);
+      std::memcpy(&bits, &fmt[14], 2);
+    } else if(!std::memcmp(id, "data", 4)) {
+      if(rate != WHISPER_SAMPLE_RATE || !channels || !((format == 1 && bits == 16) || (format == 3 && bits == 32))) {
+        std::cerr << "ERROR: " << path << " is not 16 bit or float wav at " << WHISPER_SAMPLE_RATE << " Hz" << std::endl;
+        return false;
+      }
+      std::vector<char> data(size);
+      f.read(data.data(), size);
+      size_t frames = size / (bits / 8) / channels;
+      audio.assign(frames, 0.0f);
+      for(size_t i = 0; i < frames * channels; i++) {
+        float s;
+        if(format == 1) {
+          int16_t v;
+          std::memcpy(&v, &data[i * 2], 2);
+          s = v / 32768.0f;
+        } else {
+          std::memcpy(&s, &data[i * 4], 4);
+        }
+        audio[i / channels] += s / channels;
+      }
+      return true;
+    } else {
+      //chunks are padded to an even size
+      f.seekg(size + (size & 1), std::ios::cur);
+    }
+  }
+  return false;
+}
+
+int main(int argc, char *argv[]) {
+  config::config args;
+  args.add_option('c', "config", "yaml config file (whisper settings and decodeProfiles)");
+  args.add_option('i', "input", "directory of wav files, each with its reference transcript in a .txt of the same name");
+  args.add_option('o', "output", "file to write the json results to (default stdout)", true);
+  if(args.parse_args(argc, argv, VIG_VERSION)) return EXIT_SUCCESS;
+
+  spdlog::set_level(spdlog::level::warn);
+
+  YAML::Node config;
+  try {
+    config = YAML::LoadFile(args.get_value<std::string>("config"));
+  } catch (...) {
+    std::cerr << "ERROR: failed to read yaml config file" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  //load everything up front so reading files isn't part of the timing
+  std::string input = args.get_value<std::string>("input");
+  std::vector<std::filesystem::path> paths;
+  try {
+    for(const auto& entry: std::filesystem::directory_iterator(input)) {
+      if(entry.path().extension() == ".wav") {
+        paths.push_back(entry.path());
+      }
+    }
+  } catch (const std::filesystem::filesystem_error& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::sort(paths.begin(), paths.end());
+
+  std::vector<utterance> utterances;
+  double audio_seconds = 0;
+  for(const auto& path: paths) {
+    std::filesystem::path transcript = path;
+    transcript.replace_extension(".txt");
+    std::ifstream t(transcript);
+    if(!t) {
+      std::cerr << "WARNING: no reference transcript for " << path.string() << ", skipped" << std::endl;
+      continue;
+    }
+    utterance u;
+    u.name = path.filename().string();
+    std::stringstream text;
+    text << t.rdbuf();
+    u.reference = words(text.str());
+    if(!read_wav(path.string(), u.audio)) {
+      std::cerr << "WARNING: failed to read " << path.string() << ", skipped" << std::endl;
+      continue;
+    }
+    audio_seconds += double(u.audio.size()) / WHISPER_SAMPLE_RATE;
+    utterances.push_back(std::move(u));
+  }
+  if(utterances.empty()) {
+    std::cerr << "ERROR: no wav files with transcripts could be read from " << input << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  whisper_wrapper whisp(config["whisper"]);
+
+  nlohmann::json results;
+  results["input"] = input;
+  results["files"] = utterances.size();
+  results["audio_seconds"] = audio_seconds;
+  results["results"] = nlohmann::json::array();
+
+  //one untimed decode so model loading and buffer setup aren't counted against the first profile
+  std::string text;
+  whisp.convert_audio_to_text(utterances[0].audio, utterances[0].audio.size(), text, "default");
+
+  for(const auto& profile: whisp.profile_names()) {
+    size_t errors = 0, reference_words = 0, failures = 0;
+    std::chrono::steady_clock::duration total{};
+    nlohmann::json files = nlohmann::json::array();
+    for(auto& u: utterances) {
+      auto start = std::chrono::steady_clock::now();
+      int rtn = whisp.convert_audio_to_text(u.audio, u.audio.size(), text, profile);
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      total += elapsed;
+
+      //a failed decode counts as deleting every word
+      size_t e = rtn ? u.reference.size() : word_errors(u.reference, words(text));
+      failures += rtn != 0;
+      errors += e;
+      reference_words += u.reference.size();
+      files.push_back({
+        {"file", u.name},
+        {"decode_ms", std::chrono::duration<double, std::milli>(elapsed).count()},
+        {"word_errors", e},
+        {"reference_words", u.reference.size()},
+        {"text", rtn ? "" : text}
+      });
+    }
+
+    double decode_seconds = std::chrono::duration<double>(total).count();
+    results["results"].push_back({
+      {"profile", profile},
+      {"decode_ms", decode_seconds * 1000},
+      {"mean_decode_ms", decode_seconds * 1000 / utterances.size()},
+      {"real_time_factor", decode_seconds / audio_seconds},
+      {"wer", reference_words ? double(errors) / reference_words : 0.0},
+      {"failures", failures},
+      {"files", files}
+    });
+  }
+
+  std::string output_file = args.get_value<std::string>("output");
+  if(output_file.empty()) {
+    std::cout << results.dump(2) << std::endl;
+  } else {
+    std::ofstream f(output_file);
+    if(!f) {
+      std::cerr << "ERROR: failed to write results to " << output_file << std::endl;
+      return EXIT_FAILURE;
+    }
+    f << results.dump(2) << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -2,13 +2,14 @@
 
 #include <iostream>
 #include <unistd.h>
+#include <chrono>
 #include <spdlog/spdlog.h>
 
 #include "string_utils.h"
 
 control_thread::control_thread(YAML::Node& config, image_thread& it)
   :  _whisp(config["whisper"]), _ai(config["openai"]), _au(config["audio"], _whisp, _thread_ctrl),
-    _speech(config["espeak"]), _img_thread(it)
+    _speech(config["espeak"]), _scenes(config["openai"]), _img_thread(it)
 {
   _image_words = config["openai"]["imageInclusionKeywords"].as<std::vector<std::string>>();
   _aiLocalSttOnly = config["audio"]["aiLocalSpeechDetectOnly"].as<bool>();
@@ -128,7 +129,7 @@ void control_thread::thread_handler()
       spdlog::error("Failed to capture microphone data");
       return;
     } else if(speech_result == 0) {
-      usleep(10);
+      //check_for_speech waits a while for speech, so this doesn't spin
       continue;
     }
 
@@ -212,13 +213,25 @@ void control_thread::thread_handler()
 
               //word image in request to send with current camera frame
               std::vector<uint8_t> img;
-              if(_img_thread.get_current_frame(img)) {
+              uint64_t scene;
+              if(_img_thread.get_current_frame(img, scene)) {
+                continue;
+              }
+
+              //same question about the same scene as recently, replay the previous answer
+              if(_scenes.find(scene, requestText, audio_data)) {
+                if(!_thread_ctrl.load()) break;
+
+                if(_au.play_from_mem(audio_data)) {
+                  spdlog::error("Failed to output audio data");
+                }
                 continue;
               }
 
               std::string responseText;
               int rtn;
               _au.play_from_file("./samples/please_wait.mp3");
+              auto ai_start = std::chrono::steady_clock::now();
               rtn = _ai.ai_text_image_to_text(requestText, img, responseText);
               if (rtn == -2) {
                 //AI ERROR
@@ -245,6 +258,9 @@ void control_thread::thread_handler()
                 audio_played = true;
                 continue;
               }
+
+              _scenes.add(scene, requestText, audio_data,
+                          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - ai_start).count());
             } else {
               _au.play_from_file("./samples/please_wait.mp3");
               //normal ai request without sending image
@@ -279,3 +295,17 @@ void control_thread::thread_handler()
 audio_wrapper& control_thread::get_audio() {
   return _au;
 }
+
+nlohmann::json control_thread::dump_stats() const {
+  audio_wrapper::capture_stats stats = _au.get_capture_stats();
+  return {{"audio", {
+    {"capture_overruns", stats.overruns},
+    {"dropped_samples", stats.dropped_samples},
+    {"input_overflows", stats.input_overflows},
+    {"dropped_chunks", stats.dropped_chunks},
+    {"gated_chunks", stats.gated_chunks},
+    {"evaluated_chunks", stats.evaluated_chunks},
+    {"activation_passed", stats.activation_passed},
+    {"activation_rejected", stats.activation_rejected}
+  }}};
+}
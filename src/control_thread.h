@@ -6,8 +6,10 @@
 #include <mutex>
 #include <atomic>
 #include <yaml-cpp/yaml.h>
+#include <nlohmann/json.hpp>
 
 #include "openai/ai_wrapper.h"
+#include "openai/scene_cache.h"
 #include "audio/audio_wrapper.h"
 #include "audio/espeak_wrapper.h"
 #include "image_thread.h"
@@ -24,6 +26,9 @@ public:
 
   audio_wrapper& get_audio();
 
+  //audio capture counters, for the stats dump
+  nlohmann::json dump_stats() const;
+
 private:
 
   std::thread _thread;
@@ -36,6 +41,7 @@ private:
   ai_wrapper _ai;
   audio_wrapper _au;
   speech_synth _speech;
+  scene_cache _scenes;
 
   bool _cmdLocalSttOnly;
   bool _aiLocalSttOnly;
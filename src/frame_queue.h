@@ -0,0 +1,85 @@
+#ifndef __FRAME_QUEUE_H__
+#define __FRAME_QUEUE_H__
+
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include <atomic>
+
+//bounded queue connecting one producer stage to one consumer stage
+//storage is allocated once, when full either the oldest queued item or the new item is dropped
+template<typename T>
+class frame_queue {
+public:
+  frame_queue(size_t capacity, bool drop_oldest)
+    : _items(capacity > 0 ? capacity : 1), _drop_oldest(drop_oldest) {
+    _head = 0;
+    _count = 0;
+    _dropped.store(0);
+  }
+
+  //move item into the queue, if the queue is full the dropped item is moved into dropped (so its buffers can be reused)
+  //returns true if an item was dropped
+  bool push(T& item, T& dropped) {
+    bool was_full = false;
+    {
+      std::unique_lock<std::mutex> accessLock(_mutex);
+      if(_count == _items.size()) {
+        was_full = true;
+        _dropped++;
+        if(!_drop_oldest) {
+          dropped = std::move(item);
+          return true;
+        }
+        dropped = std::move(_items[_head]);
+        _head = (_head + 1) % _items.size();
+        _count--;
+      }
+      _items[(_head + _count) % _items.size()] = std::move(item);
+      _count++;
+    }
+    _cond.notify_one();
+    return was_full;
+  }
+
+  //take the oldest item if one is queued
+  bool try_pop(T& item) {
+    std::unique_lock<std::mutex> accessLock(_mutex);
+    return pop_locked(item);
+  }
+
+  //take the oldest item, waiting up to timeout_ms for one to arrive
+  bool pop(T& item, int timeout_ms) {
+    std::unique_lock<std::mutex> accessLock(_mutex);
+    _cond.wait_for(accessLock, std::chrono::milliseconds(timeout_ms), [this]{ return _count > 0; });
+    return pop_locked(item);
+  }
+
+  //number of items dropped since creation
+  uint64_t dropped() const {
+    return _dropped.load();
+  }
+
+private:
+  std::vector<T> _items;
+  bool _drop_oldest;
+  size_t _head;
+  size_t _count;
+  std::atomic<uint64_t> _dropped;
+
+  std::mutex _mutex;
+  std::condition_variable _cond;
+
+  bool pop_locked(T& item) {
+    if(!_count) {
+      return false;
+    }
+    item = std::move(_items[_head]);
+    _head = (_head + 1) % _items.size();
+    _count--;
+    return true;
+  }
+};
+
+#endif
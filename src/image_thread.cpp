@@ -5,11 +5,27 @@
 #include <sstream>
 #include <iostream>
 #include <fstream>
+#include <chrono>
 
 extern bool running;
 
-image_thread::image_thread(YAML::Node& config) {
-  _camId = config["camera"]["camId"].as<int>();
+
+//spare frame buffers kept for reuse by each pipeline stage
+const size_t free_buffers = 4;
+
+//how long a pipeline stage waits for a frame before checking for shutdown/commands
+const int stage_timeout_ms = 100;
+
+//in luma only modes, colour is still captured for one frame in this many so snapshots have recent frames to choose from
+const uint64_t snapshot_colour_every = 8;
+
+image_thread::image_thread(YAML::Node& config)
+  : _snapshot(config["Imaging"]), _encoder(config["Imaging"]), _processor(config["Imaging"]["motionthreshold"].as<int>()),
+    _capture_queue(config["Imaging"]["queuedepth"].as<size_t>(), config["Imaging"]["queuedropoldest"].as<bool>()),
+    _display_queue(config["Imaging"]["queuedepth"].as<size_t>(), config["Imaging"]["queuedropoldest"].as<bool>()),
+    _capture_free(free_buffers, false), _display_free(free_buffers, false),
+    _pacer(config["Imaging"]["targetfps"].as<double>()), _governor(config["Imaging"])
+{
   _cmd_pending = false;
   _audio_pending = false;
   _speech_pending = false;
@@ -50,9 +66,22 @@ image_thread::image_thread(YAML::Node& config) {
   _RRimageedgeno = config["Imaging"]["imageedgeno"].as<int>();
   _RRimagethresh_lev = config["Imaging"]["imagethresh-lev"].as<int>();
   _RRimagethreshmode = config["Imaging"]["imagethreshmode"].as<int>();
+  _RRprocessingscale = config["Imaging"]["processingscale"].as<int>();
+  if(_RRprocessingscale != 1 && _RRprocessingscale != 2 && _RRprocessingscale != 4) {
+    spdlog::warn("invalid processingscale {}, using full resolution", _RRprocessingscale);
+    _RRprocessingscale = 1;
+  }
+
+  _RRstatsinterval = config["Imaging"]["statsinterval"].as<int>();
+  _RRstatsfile = config["Imaging"]["statsfile"].as<std::string>();
+
+  _RRdisplaywidth = config["Imaging"]["displaywidth"].as<int>();
+  _RRdisplayheight = config["Imaging"]["displayheight"].as<int>();
 
   _RRusedebugcamera = config["Imaging"]["usedebugcamera"].as<bool>();
-  _RRglassesfullscreen = config["Imaging"]["glassesfullscreen"].as<bool>();
+
+  _camera = create_camera(config["camera"], _RRusedebugcamera);
+  _display = create_display_sink(config["Imaging"]);
 }
 
 image_thread::~image_thread() {
@@ -77,18 +106,36 @@ bool image_thread::is_running() {
   return _running;
 }
 
-int image_thread::get_current_frame(std::vector<uint8_t>& jpg) {
-  std::unique_lock<std::recursive_mutex> accessLock(_mutex);
-  //encode currFrame to jpg
-  jpg.clear();
-  //jpg.reserve(1024*1024*4); //reserve excessive buffer
-  cv::imencode(".jpg", _currFrame, jpg);
+pipeline_stats::drops image_thread::dropped_frames() {
+  return {_camera ? _camera->dropped() : 0, _capture_queue.dropped(), _display_queue.dropped()};
+}
+
+int image_thread::dump_stats(const nlohmann::json& extra) {
+  nlohmann::json j = _stats.dump(dropped_frames());
+  j.update(extra);
+  j["quality"] = {
+    {"level", _governor.level()},
+    {"adjustments", _governor.adjustments()},
+    {"soc_temperature", _governor.temperature()}
+  };
+
+  std::ofstream f(_RRstatsfile);
+  if(!f) {
+    spdlog::error("failed to write image stats to {}", _RRstatsfile);
+    return -1;
+  }
+  f << j.dump(2) << std::endl;
+  spdlog::info("stats written to {}", _RRstatsfile);
   return 0;
 }
 
+int image_thread::get_current_frame(std::vector<uint8_t>& jpg, uint64_t& scene) {
+  //snapshot is requested from the capture loop and encoded on this thread (does not hold up the video)
+  return _encoder.encode(_snapshot, jpg, scene);
+}
+
 void image_thread::thread_handler() {
-  cv::VideoCapture camera(_camId, cv::CAP_V4L2);
-  if(!camera.isOpened())
+  if(!_camera || _camera->open())
   {
     spdlog::error("Can't find camera");
     play_audio_file("./samples/camera_not_found.mp3");
@@ -106,91 +153,127 @@ void image_thread::thread_handler() {
   // set mic volume at 100
   system(_RRmicvol.c_str());
 
-if (!_RRusedebugcamera){
-  /* THESE WORK ON GLASSES BUT NOT WEBCAM*/
-  camera.set(cv::CAP_PROP_FRAME_WIDTH, 1920);
-  camera.set(cv::CAP_PROP_FRAME_HEIGHT, 1080);
+  if(!_display || _display->open())
+  {
+    spdlog::error("failed to open display");
+    return;
   }
-  // create a window to display the images from the webcam
-  cv::namedWindow("RoboRob", cv::WINDOW_NORMAL);
-  if (_RRglassesfullscreen){
-     cv::setWindowProperty("RoboRob",cv::WND_PROP_FULLSCREEN,cv::WINDOW_FULLSCREEN);
+
+  // everything after capture works at the size the display can actually show
+  cv::Size display(_RRdisplaywidth, _RRdisplayheight);
+  if (display.area() == 0) {
+    display = _display->size();
   }
+  cv::Size output = output_size(display, _camera->size());
+  _processor.set_output(output);
+  spdlog::info("display {}x{}, capture {}x{}, processing at {}x{}", display.width, display.height,
+               _camera->size().width, _camera->size().height, output.width, output.height);
+
+  // pace the display to the camera frame rate (unless a target rate is configured)
+  _pacer.set_source_fps(_camera->fps());
+
+  _capture_formats.store(frame_bgr | frame_luma);
+
+  // start the capture and display stages, this thread does the processing between them
+  std::thread capture_thread(&image_thread::capture_handler, this);
+  std::thread display_thread(&image_thread::display_handler, this);
 
-  // array to hold image
-  cv::Mat img;
+  // captured frame being processed and the output frame for display
+  frame in;
+  frame out;
+  frame dropped;
+  frame spare;
   int mode = _RRimagemode;
   int zoom = _RRimagezoom;
+  int crop_zoom = -1;
   int edgeno = _RRimageedgeno;
   int thresh_lev = _RRimagethresh_lev;
   int threshmode = _RRimagethreshmode;
 
+  // pipeline stats are reported every statsinterval seconds
+  auto report_time = std::chrono::steady_clock::now();
+  uint64_t frame_count = 0;
 
 
   while(_thread_ctrl.load()) {
 
-    // capture the next frame from the webcam
-    camera >> img;
-
-//   cv::resize(img, img, cv::Size(1920, 1080));  /* only needed with the test webcam*/
-    // zoom the image before any processing
-    img = img(cv::Rect(zoom*95, zoom*54, (1920-(zoom*190)), (1080 - (zoom * 108))));
+    // let the camera crop to the zoom region when it can, the remap below does whatever is left
+    if(zoom != crop_zoom) {
+      _camera->set_crop(_processor.region(zoom));
+      crop_zoom = zoom;
+    }
 
-    //make image full size again
-    cv::resize(img, img, cv::Size(1920, 1080));
+    // wait for the next captured frame (times out so commands are still handled if the camera stalls)
+    bool have_frame = _capture_queue.pop(in, stage_timeout_ms);
 
-    {
-      //take control of mutex to keep thread safe access to currFrame member for ai image requests
-      std::unique_lock<std::recursive_mutex> accessLock(_mutex);
-      _currFrame = img.clone();
+    // while the governor is shedding frame rate only every n'th frame is processed, the rest go straight back
+    if(have_frame && (++frame_count % _governor.settings().fps_divider) != 0) {
+      _capture_free.push(in, spare);
+      have_frame = false;
     }
 
-    if (mode == 2) {
-      // edge detection
-      // Convert to graycsale
-      cv::Mat img_gray;
-      cv::cvtColor(img, img_gray, cv::COLOR_BGR2GRAY);
+    if(have_frame) {
 
-      // Blur the image for better edge detection
-      cv::Mat img_blur;
-      cv::GaussianBlur(img_gray, img_blur, cv::Size(7, 7), 0);
+      // reuse a buffer the display stage has finished with for the output
+      _display_free.try_pop(out);
 
-      // Canny edge detection
-      cv::Mat edges;
-      cv::Canny(img_blur, edges, edgeno, edgeno, 3, false);
+      // zoom the image before any processing
+      auto zoom_start = std::chrono::steady_clock::now();
+      _processor.zoom(in, out, zoom);
 
-      // make edges wider
-      cv::Mat wide_edges;
-      cv::dilate(edges, wide_edges, cv::Mat(), cv::Point(-1 ,-1), 2, 1, 1);
+      auto snapshot_start = std::chrono::steady_clock::now();
+      _stats.record(stage_zoom, snapshot_start - zoom_start);
 
-      cv::Mat col_edges;
-      cv::cvtColor(wide_edges, col_edges, cv::COLOR_GRAY2BGR);
-      // set edges to yellow
-      col_edges.setTo(cv::Scalar(0, 255, 255),col_edges);
+      // input buffers go back to the capture stage
+      _capture_free.push(in, spare);
 
-      // "overlay" the edges on the colour image
-      img = img + col_edges;
+      //offer the frame for ai image requests (only copied if it is the sharpest recent frame, or one has been requested)
+      if(out.formats & frame_bgr) {
+        _snapshot.publish(out.image, (out.formats & frame_luma) ? out.luma : cv::Mat(), out.seq);
+      }
 
-    }
+      auto process_start = std::chrono::steady_clock::now();
+      _stats.record(stage_snapshot, process_start - snapshot_start);
 
-    if (mode == 3) {
-      cv::Mat img_gray;
-      cv::cvtColor(img, img_gray, cv::COLOR_BGR2GRAY);
+      // detection resolution divider, lowered further by the governor when frames are slow or the soc is hot
+      const int scale = std::min(4, _RRprocessingscale * _governor.settings().scale_factor);
+      _processor.process(out, {mode, zoom, edgeno, thresh_lev, threshmode, scale});
 
-      cv::threshold(img_gray, img, thresh_lev, 255, threshmode);
-      // set colour to yellow
-      cv::cvtColor(img, img, cv::COLOR_GRAY2BGR);
-      img.setTo(cv::Scalar(0, 255, 255),img);
-    }
+      // representations the capture stage should provide for the current mode (colour is also needed for snapshots)
+      int formats = image_processor::wanted_formats(mode);
+      if (_snapshot.pending() || frame_count % snapshot_colour_every == 0) {
+        formats |= frame_bgr;
+      }
+      _capture_formats.store(formats);
 
-    // show the image on the window
-    cv::imshow("RoboRob", img);
+      auto process_end = std::chrono::steady_clock::now();
+      _stats.record(stage_process, process_end - process_start);
 
-    // wait (10ms) for esc key to be pressed to stop // need this to let the display happen?
+      // step quality down/up to keep within the frame time budget and soc temperature
+      if (_governor.frame_processed(std::chrono::duration<double, std::milli>(process_end - process_start).count())) {
+        _processor.set_blur(_governor.settings().blur_size);
+        _pacer.set_divider(_governor.settings().fps_divider);
+      }
+      if (process_end - report_time >= std::chrono::seconds(_RRstatsinterval)) {
+        //processing time itself is in the stage histograms reported below
+        spdlog::debug("processing mode {} at scale 1/{}", mode, scale);
+        if (mode == 2) {
+          spdlog::debug("edge masks reused for {:.0f}% of strips (static scene)", _processor.take_reuse_ratio() * 100);
+        }
+        spdlog::debug("quality level {} ({} adjustments), soc {:.1f} C", _governor.level(), _governor.adjustments(),
+                      _governor.temperature());
+        _stats.report(dropped_frames());
+        report_time = process_end;
+      }
 
-    cv::waitKey(10);
+      // pass to the display stage, a frame dropped from the queue has its buffer reused
+      if(_display_queue.push(out, dropped)) {
+        _display_free.push(dropped, spare);
+      }
+    }
 
     bool gotit = 0;
+    auto commands_start = std::chrono::steady_clock::now();
     //check for control command
     {
       std::unique_lock<std::recursive_mutex> accessLock(_cmd_mutex);
@@ -522,9 +605,73 @@ if (!_RRusedebugcamera){
           }
         }
         _cmd_pending = false;
+        _stats.record(stage_commands, std::chrono::steady_clock::now() - commands_start);
       }
     }
   }
+
+  capture_thread.join();
+  display_thread.join();
+}
+
+void image_thread::capture_handler() {
+  frame f;
+  frame dropped;
+  frame spare;
+  uint64_t seq = 0;
+
+  while(_thread_ctrl.load()) {
+    // reuse a buffer the processing stage has finished with (the camera writes into it in place)
+    _capture_free.try_pop(f);
+
+    // capture the next frame from the webcam, in the representations the processing stage needs
+    // (includes waiting for the camera, so this is the frame interval when processing keeps up)
+    auto capture_start = std::chrono::steady_clock::now();
+    if(_camera->read(f, _capture_formats.load())) {
+      spdlog::warn("failed to capture camera frame");
+      std::this_thread::sleep_for(std::chrono::milliseconds(stage_timeout_ms));
+      continue;
+    }
+    _stats.record(stage_capture, std::chrono::steady_clock::now() - capture_start);
+    f.seq = ++seq;
+
+    // if processing is behind, a frame is dropped according to the queue policy
+    if(_capture_queue.push(f, dropped)) {
+      _capture_free.push(dropped, spare);
+    }
+  }
+}
+
+void image_thread::display_handler() {
+  frame f;
+  frame spare;
+
+  while(_thread_ctrl.load()) {
+    if(!_display_queue.pop(f, stage_timeout_ms)) {
+      // keep the window responsive while no frames arrive
+      _display->poll();
+      continue;
+    }
+
+    // show the image (window, or composed straight into the framebuffer)
+    auto display_start = std::chrono::steady_clock::now();
+    _display->show(f.image);
+
+    // let the window system draw the frame
+    auto poll_start = std::chrono::steady_clock::now();
+    _display->poll();
+
+    auto shown = std::chrono::steady_clock::now();
+    _stats.record(stage_display, poll_start - display_start);
+    _stats.record(stage_poll, shown - poll_start);
+    _stats.record(stage_latency, shown - f.captured);
+
+    // buffer goes back to the processing stage
+    _display_free.push(f, spare);
+
+    // wait for whatever is left of this frame's time budget
+    _pacer.frame_shown();
+  }
 }
 
 void image_thread::send_cmd(const std::string cmd) {
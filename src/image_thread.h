@@ -7,6 +7,17 @@
 #include <yaml-cpp/yaml.h>
 #include <opencv2/opencv.hpp>
 
+#include "imaging/image_processor.h"
+#include "imaging/display_sink.h"
+#include "imaging/display_size.h"
+#include "imaging/quality_governor.h"
+#include "imaging/frame_snapshot.h"
+#include "imaging/snapshot_encoder.h"
+#include "imaging/frame.h"
+#include "frame_queue.h"
+#include "imaging/display_scheduler.h"
+#include "imaging/camera_source.h"
+#include "imaging/pipeline_stats.h"
 
 class image_thread {
 public:
@@ -18,7 +29,11 @@ public:
   void cancel();
   bool is_running();
 
-  int get_current_frame(std::vector<uint8_t>& jpg);
+  //current frame as jpg, with its scene hash (for recognising repeat requests about the same scene)
+  int get_current_frame(std::vector<uint8_t>& jpg, uint64_t& scene);
+
+  //write the pipeline stats, with extra sections from elsewhere (e.g. audio capture), to statsfile
+  int dump_stats(const nlohmann::json& extra = nlohmann::json::object());
 
   void send_cmd(const std::string cmd);
 
@@ -34,7 +49,8 @@ private:
   std::recursive_mutex _mutex;
   bool _running;
 
-  int _camId;
+  std::unique_ptr<camera_source> _camera;
+  std::unique_ptr<display_sink> _display;
   std::string _RRzoomin;
   std::string _RRzoomout;
   std::string _RRedges;
@@ -70,11 +86,37 @@ private:
   int _RRimageedgeno;
   int _RRimagethresh_lev;
   int _RRimagethreshmode;
+  int _RRprocessingscale;
+  int _RRstatsinterval;
+  std::string _RRstatsfile;
+  int _RRdisplaywidth;
+  int _RRdisplayheight;
   
   bool _RRusedebugcamera;
-  bool _RRglassesfullscreen;
   
-  cv::Mat _currFrame;
+  frame_snapshot _snapshot;
+  snapshot_encoder _encoder;
+
+  //zoom and mode processing
+  image_processor _processor;
+
+  //pipeline: capture -> processing -> display, with spare buffers passed back up for reuse
+  frame_queue<frame> _capture_queue;
+  frame_queue<frame> _display_queue;
+  frame_queue<frame> _capture_free;
+  frame_queue<frame> _display_free;
+
+  //frame representations (frame_bgr/frame_luma) the processing stage wants from capture
+  std::atomic<int> _capture_formats;
+
+  display_scheduler _pacer;
+
+  //steps processing quality with frame time and soc temperature
+  quality_governor _governor;
+
+  //per stage timings, written by all three pipeline stages
+  pipeline_stats _stats;
+  pipeline_stats::drops dropped_frames();
 
   std::recursive_mutex _cmd_mutex;
   bool _cmd_pending;
@@ -90,6 +132,8 @@ private:
   bool _muted;
 
   void thread_handler();
+  void capture_handler();
+  void display_handler();
 
 
   void play_audio_file(const std::string file);
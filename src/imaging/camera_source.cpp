@@ -0,0 +1,44 @@
+#include "camera_source.h"
+
+#include <spdlog/spdlog.h>
+
+#include "opencv_camera.h"
+#include "v4l2_camera.h"
+#include "replay_camera.h"
+
+void expand_luma(const cv::Mat& y, cv::Mat& luma) {
+  static const cv::Mat table = [] {
+    cv::Mat t(1, 256, CV_8U);
+    for(int i = 0; i < 256; i++) {
+      t.at<uint8_t>(i) = cv::saturate_cast<uint8_t>((i - 16) * 255.0 / 219.0);
+    }
+    return t;
+  }();
+  cv::LUT(y, table, luma);
+}
+
+std::unique_ptr<camera_source> create_camera(YAML::Node config, bool debug_camera) {
+  std::string backend = config["backend"].as<std::string>();
+  int id = config["camId"].as<int>();
+  int width = config["width"].as<int>();
+  int height = config["height"].as<int>();
+  std::string format = config["format"].as<std::string>();
+
+  if(backend == "v4l2") {
+    return std::make_unique<v4l2_camera>("/dev/video" + std::to_string(id), width, height, format, config["buffers"].as<int>(),
+                                         config["sensorCrop"].as<bool>());
+  } else if(backend == "opencv") {
+    /* setting the size works on glasses but not on the debug webcam */
+    if(debug_camera) {
+      width = 0;
+      height = 0;
+    }
+    return std::make_unique<opencv_camera>(id, width, height);
+  } else if(backend == "replay") {
+    return std::make_unique<replay_camera>(config["replayFile"].as<std::string>(), width, height, format,
+                                           config["replayFps"].as<double>(), config["replayLoop"].as<bool>());
+  }
+
+  spdlog::error("unknown camera backend: {}", backend);
+  return nullptr;
+}
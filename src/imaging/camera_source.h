@@ -0,0 +1,42 @@
+#ifndef __CAMERA_SOURCE_H__
+#define __CAMERA_SOURCE_H__
+
+#include <memory>
+#include <yaml-cpp/yaml.h>
+
+#include "frame.h"
+
+//source of frames for the image pipeline
+class camera_source {
+public:
+  virtual ~camera_source() {}
+
+  //returns 0 on success
+  virtual int open() = 0;
+
+  //capture the next frame and set f.captured, existing buffers are reused where possible
+  //formats (frame_bgr/frame_luma) are the representations wanted, f.formats is set to those actually provided
+  //returns 0 on success
+  virtual int read(frame& f, int formats) = 0;
+
+  //nominal frame rate of the source (0 if unknown)
+  virtual double fps() const = 0;
+
+  //size of uncropped frames, valid once opened
+  virtual cv::Size size() const = 0;
+
+  //ask the device to capture only region (a fraction of the full field of view), f.view reports what was applied
+  //devices that can't crop ignore this and keep returning the full view
+  virtual void set_crop(const cv::Rect2f& /*region*/) {}
+
+  //frames lost by the device/driver since opening
+  virtual uint64_t dropped() const { return 0; }
+};
+
+//expand limited range (16-235) Y from a YUV capture to the full range luma BGR2GRAY gives, in place is allowed
+void expand_luma(const cv::Mat& y, cv::Mat& luma);
+
+//create the capture backend selected in the camera config section (nullptr if invalid)
+std::unique_ptr<camera_source> create_camera(YAML::Node config, bool debug_camera);
+
+#endif
@@ -0,0 +1,148 @@
+#include "contrast_filter.h"
+
+#include <opencv2/core/hal/intrin.hpp>
+
+#include <algorithm>
+
+//fixed point BGR to gray weights, identical to cv::cvtColor(COLOR_BGR2GRAY)
+const int gray_shift = 14;
+const int gray_b = 1868;
+const int gray_g = 9617;
+const int gray_r = 4899;
+
+const int min_strip_rows = 32;
+
+//threshold one row of BGR pixels in place, yellow where (gray > thresh) != invert, black otherwise
+static void threshold_row(uint8_t* p, int width, int thresh, bool invert) {
+  //gray > thresh  <=>  (sum + half) >> shift >= thresh + 1  <=>  sum >= ((thresh + 1) << shift) - half
+  const int limit = ((thresh + 1) << gray_shift) - (1 << (gray_shift - 1));
+  int x = 0;
+
+#if CV_SIMD128
+  using namespace cv;
+  const v_int16x8 w_bg(gray_b, gray_g, gray_b, gray_g, gray_b, gray_g, gray_b, gray_g);
+  const v_int16x8 w_r0(gray_r, 0, gray_r, 0, gray_r, 0, gray_r, 0);
+  const v_int16x8 zero16 = v_setzero_s16();
+  const v_int32x4 vlimit = v_setall_s32(limit);
+  const v_uint8x16 zero8 = v_setzero_u8();
+
+  for(; x <= width - 16; x += 16, p += 48) {
+    v_uint8x16 b, g, r;
+    v_load_deinterleave(p, b, g, r);
+
+    v_uint16x8 b16[2], g16[2], r16[2];
+    v_expand(b, b16[0], b16[1]);
+    v_expand(g, g16[0], g16[1]);
+    v_expand(r, r16[0], r16[1]);
+
+    v_int16x8 m16[2];
+    for(int h = 0; h < 2; h++) {
+      //pair up (b,g) and (r,0) so each dot product gives part of the weighted sum for 4 pixels
+      v_int16x8 bg0, bg1, r0, r1;
+      v_zip(v_reinterpret_as_s16(b16[h]), v_reinterpret_as_s16(g16[h]), bg0, bg1);
+      v_zip(v_reinterpret_as_s16(r16[h]), zero16, r0, r1);
+
+      v_int32x4 sum0 = v_dotprod(bg0, w_bg) + v_dotprod(r0, w_r0);
+      v_int32x4 sum1 = v_dotprod(bg1, w_bg) + v_dotprod(r1, w_r0);
+
+      m16[h] = v_pack(sum0 >= vlimit, sum1 >= vlimit);
+    }
+
+    v_uint8x16 mask = v_reinterpret_as_u8(v_pack(m16[0], m16[1]));
+    if(invert) {
+      mask = ~mask;
+    }
+
+    //yellow is (0,255,255), black (0,0,0)
+    v_store_interleave(p, zero8, mask, mask);
+  }
+#endif
+
+  for(; x < width; x++, p += 3) {
+    int sum = p[0] * gray_b + p[1] * gray_g + p[2] * gray_r;
+    uint8_t v = ((sum >= limit) != invert) ? 255 : 0;
+    p[0] = 0;
+    p[1] = v;
+    p[2] = v;
+  }
+}
+
+//threshold one row of luminance into BGR output, yellow where (luma > thresh) != invert, black otherwise
+static void threshold_luma_row(const uint8_t* l, uint8_t* p, int width, int thresh, bool invert) {
+  int x = 0;
+
+#if CV_SIMD128
+  using namespace cv;
+  if(thresh >= 0 && thresh < 255) {
+    const v_uint8x16 vthresh = v_setall_u8((uint8_t)thresh);
+    const v_uint8x16 zero8 = v_setzero_u8();
+
+    for(; x <= width - 16; x += 16, p += 48) {
+      v_uint8x16 mask = v_load(l + x) > vthresh;
+      if(invert) {
+        mask = ~mask;
+      }
+      v_store_interleave(p, zero8, mask, mask);
+    }
+  }
+#endif
+
+  for(; x < width; x++, p += 3) {
+    uint8_t v = ((l[x] > thresh) != invert) ? 255 : 0;
+    p[0] = 0;
+    p[1] = v;
+    p[2] = v;
+  }
+}
+
+contrast_filter::contrast_filter() {
+}
+
+void contrast_filter::threshold(cv::Mat& img, int thresh, bool invert) {
+  const int width = img.cols;
+
+  cv::parallel_for_(cv::Range(0, img.rows), [&](const cv::Range& r) {
+    for(int y = r.start; y < r.end; y++) {
+      threshold_row(img.ptr<uint8_t>(y), width, thresh, invert);
+    }
+  }, std::max(1, img.rows / min_strip_rows));
+}
+
+void contrast_filter::apply(cv::Mat& img, int thresh, int threshmode, int scale) {
+  const bool invert = (threshmode == 1);
+
+  if(scale <= 1) {
+    threshold(img, thresh, invert);
+    return;
+  }
+
+  //threshold a downscaled copy and upsample the two colour result back into img
+  cv::resize(img, _small, cv::Size((img.cols + scale - 1) / scale, (img.rows + scale - 1) / scale), 0, 0, cv::INTER_AREA);
+  threshold(_small, thresh, invert);
+  cv::resize(_small, img, img.size(), 0, 0, cv::INTER_NEAREST);
+}
+
+void contrast_filter::threshold_luma(const cv::Mat& luma, cv::Mat& img, int thresh, bool invert) {
+  const int width = luma.cols;
+  img.create(luma.size(), CV_8UC3);
+
+  cv::parallel_for_(cv::Range(0, luma.rows), [&](const cv::Range& r) {
+    for(int y = r.start; y < r.end; y++) {
+      threshold_luma_row(luma.ptr<uint8_t>(y), img.ptr<uint8_t>(y), width, thresh, invert);
+    }
+  }, std::max(1, luma.rows / min_strip_rows));
+}
+
+void contrast_filter::apply_luma(const cv::Mat& luma, cv::Mat& img, int thresh, int threshmode, int scale) {
+  const bool invert = (threshmode == 1);
+
+  if(scale <= 1) {
+    threshold_luma(luma, img, thresh, invert);
+    return;
+  }
+
+  cv::resize(luma, _small_luma, cv::Size((luma.cols + scale - 1) / scale, (luma.rows + scale - 1) / scale), 0, 0, cv::INTER_AREA);
+  threshold_luma(_small_luma, _small, thresh, invert);
+  img.create(luma.size(), CV_8UC3);
+  cv::resize(_small, img, img.size(), 0, 0, cv::INTER_NEAREST);
+}
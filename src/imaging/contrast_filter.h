@@ -0,0 +1,27 @@
+#ifndef __CONTRAST_FILTER_H__
+#define __CONTRAST_FILTER_H__
+
+#include <opencv2/opencv.hpp>
+
+//contrast mode: thresholds the frame brightness into a two colour (yellow/black) image
+//single vectorised pass straight from BGR input to BGR output, done in place
+class contrast_filter {
+public:
+  contrast_filter();
+
+  //threshmode 0: brighter than thresh is yellow, 1: inverted
+  //scale (1, 2 or 4) divides the resolution the threshold is computed at, the result is upsampled into img
+  void apply(cv::Mat& img, int thresh, int threshmode, int scale = 1);
+
+  //as apply, but thresholds a luminance plane directly, writing the two colour result into img
+  void apply_luma(const cv::Mat& luma, cv::Mat& img, int thresh, int threshmode, int scale = 1);
+
+private:
+  cv::Mat _small;
+  cv::Mat _small_luma;
+
+  void threshold(cv::Mat& img, int thresh, bool invert);
+  void threshold_luma(const cv::Mat& luma, cv::Mat& img, int thresh, bool invert);
+};
+
+#endif
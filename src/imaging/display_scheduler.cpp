@@ -0,0 +1,36 @@
+#include "display_scheduler.h"
+
+#include <thread>
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+//frame rate assumed if neither the config nor the camera provide one
+const double default_fps = 30.0;
+
+display_scheduler::display_scheduler(double target_fps) {
+  _target_fps = target_fps;
+  _divider = 1;
+  set_source_fps(0);
+}
+
+void display_scheduler::set_source_fps(double fps) {
+  double rate = (_target_fps > 0) ? _target_fps : (fps > 0) ? fps : default_fps;
+  _interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / rate));
+  spdlog::info("display paced at {:.1f} fps", rate);
+}
+
+void display_scheduler::set_divider(int divider) {
+  _divider = std::max(1, divider);
+}
+
+void display_scheduler::frame_shown() {
+  auto now = std::chrono::steady_clock::now();
+
+  //next frame is due one interval after this one was due, unless we are already late (then start again from now)
+  _deadline += _interval * _divider.load();
+  if(_deadline <= now) {
+    _deadline = now;
+    return;
+  }
+  std::this_thread::sleep_until(_deadline);
+}
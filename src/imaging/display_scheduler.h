@@ -0,0 +1,29 @@
+#ifndef __DISPLAY_SCHEDULER_H__
+#define __DISPLAY_SCHEDULER_H__
+
+#include <chrono>
+#include <atomic>
+
+//paces the display stage to the camera frame interval (or a configured target fps)
+//only sleeps for what is left of each frame's budget
+class display_scheduler {
+public:
+  display_scheduler(double target_fps);
+
+  //camera frame rate, used for pacing if no target fps is configured
+  void set_source_fps(double fps);
+
+  //show only every n'th frame interval (the processing stage skips the frames in between)
+  void set_divider(int divider);
+
+  //call once a frame has been shown, waits out the rest of the frame interval
+  void frame_shown();
+
+private:
+  double _target_fps;
+  std::chrono::steady_clock::duration _interval;
+  std::atomic<int> _divider;
+  std::chrono::steady_clock::time_point _deadline;
+};
+
+#endif
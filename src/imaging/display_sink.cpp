@@ -0,0 +1,30 @@
+#include "display_sink.h"
+
+#include <spdlog/spdlog.h>
+
+#include "highgui_sink.h"
+#include "fbdev_sink.h"
+#include "memfd_sink.h"
+#include "null_sink.h"
+
+std::unique_ptr<display_sink> create_display_sink(YAML::Node config) {
+  std::string backend = config["display"].as<std::string>();
+  cv::Size size(config["displaywidth"].as<int>(), config["displayheight"].as<int>());
+
+  if(backend == "highgui") {
+    return std::make_unique<highgui_sink>("RoboRob", config["glassesfullscreen"].as<bool>());
+  } else if(backend == "fbdev") {
+    return std::make_unique<fbdev_sink>(config["fbdevice"].as<std::string>());
+  } else if(backend == "memfd") {
+    if(size.area() == 0) {
+      spdlog::error("the memfd display needs displaywidth and displayheight");
+      return nullptr;
+    }
+    return std::make_unique<memfd_sink>(size);
+  } else if(backend == "null") {
+    return std::make_unique<null_sink>(size);
+  }
+
+  spdlog::error("unknown display backend: {}", backend);
+  return nullptr;
+}
@@ -0,0 +1,29 @@
+#ifndef __DISPLAY_SINK_H__
+#define __DISPLAY_SINK_H__
+
+#include <memory>
+#include <yaml-cpp/yaml.h>
+#include <opencv2/opencv.hpp>
+
+//destination for the frames the image pipeline shows
+class display_sink {
+public:
+  virtual ~display_sink() {}
+
+  //returns 0 on success
+  virtual int open() = 0;
+
+  //size of the display surface (empty if unknown, frames are then shown at any size)
+  virtual cv::Size size() const = 0;
+
+  //show a frame (8-bit BGR), called from the display stage only
+  virtual void show(const cv::Mat& img) = 0;
+
+  //handle window system events, called after each frame and while waiting for frames
+  virtual void poll() {}
+};
+
+//create the display backend selected in the Imaging config section (nullptr if invalid)
+std::unique_ptr<display_sink> create_display_sink(YAML::Node config);
+
+#endif
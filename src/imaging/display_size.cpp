@@ -0,0 +1,42 @@
+#include "display_size.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/fb.h>
+
+cv::Size detect_display_size(const std::string& device) {
+  int fd = ::open(device.c_str(), O_RDONLY);
+  if(fd < 0) {
+    return cv::Size();
+  }
+
+  struct fb_var_screeninfo info;
+  cv::Size size;
+  if(ioctl(fd, FBIOGET_VSCREENINFO, &info) == 0) {
+    size = cv::Size(info.xres, info.yres);
+  }
+  ::close(fd);
+  return size;
+}
+
+cv::Size output_size(cv::Size display, cv::Size capture) {
+  if(capture.area() == 0) {
+    return display;
+  }
+  if(display.area() == 0) {
+    return capture;
+  }
+
+  //largest size with the capture aspect ratio that fits the display
+  cv::Size size;
+  if((int64_t)capture.width * display.height > (int64_t)display.width * capture.height) {
+    size = cv::Size(display.width, (int)((int64_t)display.width * capture.height / capture.width));
+  } else {
+    size = cv::Size((int)((int64_t)display.height * capture.width / capture.height), display.height);
+  }
+
+  size.width = std::min(size.width, capture.width);
+  size.height = std::min(size.height, capture.height);
+  return size;
+}
@@ -0,0 +1,14 @@
+#ifndef __DISPLAY_SIZE_H__
+#define __DISPLAY_SIZE_H__
+
+#include <string>
+#include <opencv2/opencv.hpp>
+
+//visible size of the attached display, read from the linux framebuffer (empty if it can't be read)
+cv::Size detect_display_size(const std::string& device = "/dev/fb0");
+
+//size the pipeline zooms, processes and shows frames at
+//the capture aspect ratio fitted inside the display, and no larger than the capture (the window scales it up)
+cv::Size output_size(cv::Size display, cv::Size capture);
+
+#endif
@@ -0,0 +1,159 @@
+#include "edge_overlay.h"
+
+#include <algorithm>
+
+//rows either side of a strip needed so the strip result matches the full frame:
+//blur radius (3) + sobel/non-max suppression (2) + dilation (2)
+const int strip_halo = 8;
+const int min_strip_rows = 32;
+
+const int default_blur_size = 7;
+const int dilate_iterations = 2;
+
+//motion detection compares averages of blocks this size (in detection pixels)
+const int motion_block = 16;
+//recompute a static strip after this many frames anyway, so slow changes are never missed for long
+const int max_reuse_frames = 30;
+
+edge_overlay::edge_overlay(int motion_threshold) {
+  _shift = 0;
+  _blur_size = default_blur_size;
+  _motion_threshold = motion_threshold;
+  _threshold = -1;
+  _strips_run = 0;
+  _strips_reused = 0;
+}
+
+void edge_overlay::setup(cv::Size size, int scale) {
+  _size = size;
+  _shift = (scale >= 4) ? 2 : (scale >= 2) ? 1 : 0;
+
+  //round up so every output pixel maps onto a mask pixel
+  _work_size = cv::Size((size.width + (1 << _shift) - 1) >> _shift, (size.height + (1 << _shift) - 1) >> _shift);
+  _gray.create(_work_size, CV_8UC1);
+
+  int num_strips = std::max(1, std::min(cv::getNumThreads() * 2, _work_size.height / min_strip_rows));
+  _strips.clear();
+  _strips.resize(num_strips);
+  for(int i = 0; i < num_strips; i++) {
+    _strips[i].start = (_work_size.height * i) / num_strips;
+    _strips[i].end = (_work_size.height * (i + 1)) / num_strips;
+    _strips[i].age = max_reuse_frames;
+  }
+  _threshold = -1;
+}
+
+bool edge_overlay::strip_changed(strip& s, int ext_start, int ext_end, bool force) {
+  if(_motion_threshold <= 0) {
+    return true;
+  }
+
+  //one pass of area averaging, much cheaper than the blur/canny/dilate it can save
+  cv::Size blocks((_work_size.width + motion_block - 1) / motion_block, (ext_end - ext_start + motion_block - 1) / motion_block);
+  cv::resize(_src.rowRange(ext_start, ext_end), s.blocks, blocks, 0, 0, cv::INTER_AREA);
+
+  //compared against the blocks the mask was computed from, so slow drift still accumulates into a change
+  if(force || s.age >= max_reuse_frames || s.ref_blocks.size() != s.blocks.size() ||
+     cv::norm(s.blocks, s.ref_blocks, cv::NORM_INF) > _motion_threshold) {
+    std::swap(s.blocks, s.ref_blocks);
+    s.age = 0;
+    return true;
+  }
+  s.age++;
+  return false;
+}
+
+void edge_overlay::process_strip(strip& s, cv::Mat& img, int threshold) {
+  const int ext_start = std::max(0, s.start - strip_halo);
+  const int ext_end = std::min(_work_size.height, s.end + strip_halo);
+
+  // a static strip (halo included) keeps the mask from the last frame it changed in
+  if(strip_changed(s, ext_start, ext_end, threshold != _threshold)) {
+    //keep the blur and edge widths roughly constant in output pixels when working at reduced resolution
+    const int ksize = std::max(3, (_blur_size >> _shift) | 1);
+    const int iterations = std::max(1, dilate_iterations >> _shift);
+
+    // Blur the strip (plus halo) for better edge detection, rows outside the roi are used for the border
+    cv::GaussianBlur(_src.rowRange(ext_start, ext_end), s.blur, cv::Size(ksize, ksize), 0);
+
+    // Canny edge detection, with equal thresholds hysteresis has no long range effect so strips match the full frame result
+    cv::Canny(s.blur, s.edges, threshold, threshold, 3, false);
+
+    // make edges wider
+    cv::dilate(s.edges, s.wide, cv::Mat(), cv::Point(-1, -1), iterations, cv::BORDER_REPLICATE, 1);
+    _strips_run++;
+  } else {
+    _strips_reused++;
+  }
+
+  // "overlay" the edges in yellow, same result as saturating add of (0,255,255)
+  // output rows covered by this strip, mask is upsampled (nearest) on the fly when working at reduced resolution
+  const int out_start = s.start << _shift;
+  const int out_end = std::min(_size.height, s.end << _shift);
+  for(int y = out_start; y < out_end; y++) {
+    const uint8_t* e = s.wide.ptr<uint8_t>((y >> _shift) - ext_start);
+    uint8_t* p = img.ptr<uint8_t>(y);
+    for(int x = 0; x < _size.width; x++, p += 3) {
+      if(e[x >> _shift]) {
+        p[1] = 255;
+        p[2] = 255;
+      }
+    }
+  }
+}
+
+void edge_overlay::apply(cv::Mat& img, int threshold, int scale, const cv::Mat& luma) {
+  const int shift = (scale >= 4) ? 2 : (scale >= 2) ? 1 : 0;
+  if(img.size() != _size || shift != _shift || _strips.empty()) {
+    setup(img.size(), scale);
+  }
+
+  if(!luma.empty()) {
+    // luminance already available, no colour conversion needed
+    if(_shift) {
+      cv::resize(luma, _gray, _work_size, 0, 0, cv::INTER_AREA);
+      _src = _gray;
+    } else {
+      _src = luma;
+    }
+  } else {
+    cv::Mat work = img;
+    if(_shift) {
+      cv::resize(img, _small, _work_size, 0, 0, cv::INTER_AREA);
+      work = _small;
+    }
+
+    // Convert to grayscale first, all strips need to read their halo rows before any overlay is written
+    cv::parallel_for_(cv::Range(0, (int)_strips.size()), [&](const cv::Range& r) {
+      for(int i = r.start; i < r.end; i++) {
+        cv::Mat gray = _gray.rowRange(_strips[i].start, _strips[i].end);
+        cv::cvtColor(work.rowRange(_strips[i].start, _strips[i].end), gray, cv::COLOR_BGR2GRAY);
+      }
+    });
+    _src = _gray;
+  }
+
+  cv::parallel_for_(cv::Range(0, (int)_strips.size()), [&](const cv::Range& r) {
+    for(int i = r.start; i < r.end; i++) {
+      process_strip(_strips[i], img, threshold);
+    }
+  });
+  _threshold = threshold;
+
+  // don't hold on to the frame's luma buffer, it is reused by the capture stage
+  _src.release();
+}
+
+void edge_overlay::set_blur(int size) {
+  if(size != _blur_size) {
+    _blur_size = size;
+    //existing masks were blurred differently
+    _threshold = -1;
+  }
+}
+
+double edge_overlay::take_reuse_ratio() {
+  uint64_t run = _strips_run.exchange(0);
+  uint64_t reused = _strips_reused.exchange(0);
+  return (run + reused) ? (double)reused / (run + reused) : 0;
+}
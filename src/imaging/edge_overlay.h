@@ -0,0 +1,64 @@
+#ifndef __EDGE_OVERLAY_H__
+#define __EDGE_OVERLAY_H__
+
+#include <vector>
+#include <atomic>
+#include <opencv2/opencv.hpp>
+
+//edge detection mode: finds edges and overlays them in yellow onto the frame
+//work is split into row strips processed in parallel, all intermediate buffers are kept between frames
+//strips whose content hasn't changed (block averages within motion_threshold) reuse their previous edge mask
+class edge_overlay {
+public:
+  edge_overlay(int motion_threshold = 0);
+
+  //detect edges (canny threshold) and draw them directly into img (8-bit BGR)
+  //scale (1, 2 or 4) divides the resolution edges are detected at, the mask is upsampled when drawn
+  //if the frame's luminance plane is given, edges are detected on it rather than converting img to gray
+  void apply(cv::Mat& img, int threshold, int scale = 1, const cv::Mat& luma = cv::Mat());
+
+  //gaussian blur kernel size applied before edge detection (at full resolution)
+  void set_blur(int size);
+
+  //fraction of strips whose edge mask was reused since the last call
+  double take_reuse_ratio();
+
+private:
+  struct strip {
+    int start;
+    int end;
+    cv::Mat blur;
+    cv::Mat edges;
+    cv::Mat wide;
+
+    //block averages of the strip now and when wide was computed, and frames since then
+    cv::Mat blocks;
+    cv::Mat ref_blocks;
+    int age;
+  };
+
+  //size of img and of the (possibly downscaled) frame edges are detected on
+  cv::Size _size;
+  cv::Size _work_size;
+  int _shift;
+  int _blur_size;
+
+  //largest block average change treated as a static scene (0 always recomputes)
+  int _motion_threshold;
+  //threshold the strip masks were computed with (-1 if none)
+  int _threshold;
+  std::atomic<uint64_t> _strips_run;
+  std::atomic<uint64_t> _strips_reused;
+
+  cv::Mat _small;
+  cv::Mat _gray;
+  //gray image edges are detected on for the current frame (_gray or the frame's luma plane)
+  cv::Mat _src;
+  std::vector<strip> _strips;
+
+  void setup(cv::Size size, int scale);
+  bool strip_changed(strip& s, int ext_start, int ext_end, bool force);
+  void process_strip(strip& s, cv::Mat& img, int threshold);
+};
+
+#endif
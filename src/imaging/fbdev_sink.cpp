@@ -0,0 +1,142 @@
+#include "fbdev_sink.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/fb.h>
+
+#include <spdlog/spdlog.h>
+
+fbdev_sink::fbdev_sink(const std::string device) {
+  _device = device;
+  _fd = -1;
+  _mem = nullptr;
+  _mem_len = 0;
+  _stride = 0;
+  _type = CV_8UC4;
+  _convert = -1;
+  _pages = 1;
+  _page = 0;
+}
+
+fbdev_sink::~fbdev_sink() {
+  close();
+}
+
+int fbdev_sink::open() {
+  close();
+
+  _fd = ::open(_device.c_str(), O_RDWR);
+  if(_fd < 0) {
+    spdlog::error("failed to open framebuffer {}: {}", _device, strerror(errno));
+    return -1;
+  }
+
+  struct fb_var_screeninfo var;
+  struct fb_fix_screeninfo fix;
+  if(ioctl(_fd, FBIOGET_VSCREENINFO, &var) == -1 || ioctl(_fd, FBIOGET_FSCREENINFO, &fix) == -1) {
+    spdlog::error("failed to read framebuffer info: {}", strerror(errno));
+    close();
+    return -2;
+  }
+
+  //convert straight into the framebuffer pixel layout
+  if(var.bits_per_pixel == 32) {
+    _type = CV_8UC4;
+    _convert = (var.red.offset == 16) ? cv::COLOR_BGR2BGRA : cv::COLOR_BGR2RGBA;
+  } else if(var.bits_per_pixel == 24) {
+    _type = CV_8UC3;
+    _convert = (var.red.offset == 16) ? -1 : cv::COLOR_BGR2RGB;
+  } else if(var.bits_per_pixel == 16) {
+    _type = CV_8UC2;
+    _convert = (var.red.offset == 11) ? cv::COLOR_BGR2BGR565 : cv::COLOR_BGR2RGB565;
+  } else {
+    spdlog::error("unsupported framebuffer depth {} bpp", var.bits_per_pixel);
+    close();
+    return -3;
+  }
+
+  _size = cv::Size(var.xres, var.yres);
+  _stride = fix.line_length;
+  _mem_len = fix.smem_len;
+  _mem = (uint8_t*)mmap(NULL, _mem_len, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+  if(_mem == MAP_FAILED) {
+    _mem = nullptr;
+    spdlog::error("failed to map framebuffer: {}", strerror(errno));
+    close();
+    return -4;
+  }
+
+  //double buffer by panning if the virtual screen has room for a second page
+  _pages = 1;
+  _page = 0;
+  if(var.yres_virtual >= var.yres * 2 && _mem_len >= _stride * var.yres * 2) {
+    var.yoffset = 0;
+    if(ioctl(_fd, FBIOPAN_DISPLAY, &var) == 0) {
+      _pages = 2;
+    }
+  }
+
+  clear();
+  spdlog::info("framebuffer {} {}x{} {} bpp, {} page(s)", _device, _size.width, _size.height, var.bits_per_pixel, _pages);
+  return 0;
+}
+
+void fbdev_sink::close() {
+  if(_mem) {
+    munmap(_mem, _mem_len);
+    _mem = nullptr;
+  }
+  if(_fd >= 0) {
+    ::close(_fd);
+    _fd = -1;
+  }
+}
+
+void fbdev_sink::clear() {
+  for(int p = 0; p < _pages; p++) {
+    cv::Mat(_size, _type, _mem + p * _stride * _size.height, _stride).setTo(cv::Scalar::all(0));
+  }
+}
+
+cv::Size fbdev_sink::size() const {
+  return _size;
+}
+
+void fbdev_sink::show(const cv::Mat& img) {
+  if(!_mem) {
+    return;
+  }
+
+  //write into the page not being shown (or the only page)
+  int page = (_pages > 1) ? 1 - _page : 0;
+  cv::Mat screen(_size, _type, _mem + page * _stride * _size.height, _stride);
+
+  //centre the frame, anything beyond the screen is cut off (the pipeline output is sized to fit)
+  cv::Rect dst((_size.width - img.cols) / 2, (_size.height - img.rows) / 2, img.cols, img.rows);
+  cv::Rect visible = dst & cv::Rect(0, 0, _size.width, _size.height);
+  cv::Mat src = img(cv::Rect(visible.x - dst.x, visible.y - dst.y, visible.width, visible.height));
+  if(dst != _shown) {
+    //border around the frame changed
+    clear();
+    _shown = dst;
+  }
+  cv::Mat out = screen(visible);
+  if(_convert < 0) {
+    src.copyTo(out);
+  } else {
+    cv::cvtColor(src, out, _convert);
+  }
+
+  if(_pages > 1) {
+    struct fb_var_screeninfo var;
+    if(ioctl(_fd, FBIOGET_VSCREENINFO, &var) == 0) {
+      var.yoffset = page * _size.height;
+      ioctl(_fd, FBIOPAN_DISPLAY, &var);
+    }
+    _page = page;
+  }
+}
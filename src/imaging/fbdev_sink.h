@@ -0,0 +1,47 @@
+#ifndef __FBDEV_SINK_H__
+#define __FBDEV_SINK_H__
+
+#include <string>
+
+#include "display_sink.h"
+
+//composes frames straight into mmap'd linux framebuffer memory (no window system, no intermediate copies)
+//the frame is converted to the framebuffer pixel format as it is written, centred on the screen
+//if the framebuffer has room for two pages the hidden one is written and then panned to (no tearing)
+class fbdev_sink : public display_sink {
+public:
+  fbdev_sink(const std::string device);
+  ~fbdev_sink();
+
+  int open() override;
+  cv::Size size() const override;
+  void show(const cv::Mat& img) override;
+
+protected:
+  //framebuffer memory and layout, set up by open()
+  int _fd;
+  uint8_t* _mem;
+  size_t _mem_len;
+  cv::Size _size;
+  size_t _stride;
+  int _type;
+  //colour conversion from BGR to the framebuffer format (-1 to copy as is)
+  int _convert;
+
+  //number of screen sized pages in the memory and the one currently shown
+  int _pages;
+  int _page;
+
+  //where the last frame was placed on the screen
+  cv::Rect _shown;
+
+  //clear all pages to black
+  void clear();
+
+  void close();
+
+private:
+  std::string _device;
+};
+
+#endif
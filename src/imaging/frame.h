@@ -0,0 +1,26 @@
+#ifndef __FRAME_H__
+#define __FRAME_H__
+
+#include <chrono>
+#include <opencv2/opencv.hpp>
+
+//representations a frame can carry (bit flags)
+const int frame_bgr = 1;
+const int frame_luma = 2;
+
+//a frame passed between the image pipeline stages
+struct frame {
+  //colour image (8-bit BGR)
+  cv::Mat image;
+  //luminance plane (8-bit gray), when the source can provide it without converting from BGR
+  cv::Mat luma;
+  //which of image/luma hold this frame (buffers are reused, so the other may hold an old frame)
+  int formats = frame_bgr;
+  //region of the camera's full field of view the frame covers (as a fraction of it), smaller when cropped by the device
+  cv::Rect2f view = cv::Rect2f(0, 0, 1, 1);
+
+  uint64_t seq = 0;
+  std::chrono::steady_clock::time_point captured;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "frame_snapshot.h"
+
+//sharpness is scored at this fraction of the frame size
+const int score_scale = 4;
+
+frame_snapshot::frame_snapshot(YAML::Node config) {
+  _window = std::chrono::milliseconds(config["snapshotwindow"].as<int>());
+  //slots hold atomics, so the vector is sized once at construction
+  _slots = std::vector<slot>(std::max(2, config["snapshotframes"].as<int>()));
+  _requested.store(false);
+}
+
+double frame_snapshot::sharpness(const cv::Mat& img) {
+  //variance of the laplacian: blur removes the high frequencies it responds to
+  cv::Size size(std::max(1, img.cols / score_scale), std::max(1, img.rows / score_scale));
+  cv::resize(img, _small, size, 0, 0, cv::INTER_AREA);
+  const cv::Mat* gray = &_small;
+  if(_small.channels() == 3) {
+    cv::cvtColor(_small, _gray, cv::COLOR_BGR2GRAY);
+    gray = &_gray;
+  }
+  cv::Laplacian(*gray, _laplacian, CV_16S);
+
+  cv::Scalar mean, stddev;
+  cv::meanStdDev(_laplacian, mean, stddev);
+  return stddev[0] * stddev[0];
+}
+
+static int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int frame_snapshot::best_slot(int64_t now, bool any_age) const {
+  const int64_t window = std::chrono::duration_cast<std::chrono::nanoseconds>(_window).count();
+  int best = -1;
+  int64_t best_time = 0;
+  double best_score = 0;
+  for(int i = 0; i < (int)_slots.size(); i++) {
+    const slot& s = _slots[i];
+    if(!(s.state.load(std::memory_order_acquire) & state_ready)) {
+      continue;
+    }
+    int64_t time = s.time_ns.load(std::memory_order_relaxed);
+    double score = s.score.load(std::memory_order_relaxed);
+    if(any_age) {
+      if(best < 0 || time > best_time) {
+        best = i;
+        best_time = time;
+      }
+    } else if(now - time <= window && (best < 0 || score > best_score)) {
+      best = i;
+      best_score = score;
+    }
+  }
+  return best;
+}
+
+bool frame_snapshot::pin(slot& s) {
+  uint32_t state = s.state.load(std::memory_order_acquire);
+  while(state & state_ready) {
+    if(s.state.compare_exchange_weak(state, state + state_reader, std::memory_order_acquire)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void frame_snapshot::publish(const cv::Mat& frame, const cv::Mat& luma, uint64_t seq) {
+  const double score = sharpness(luma.empty() ? frame : luma);
+  const int64_t now = now_ns();
+
+  //a sharper frame from the window is already held (unless a reader is waiting for any frame)
+  int best = best_slot(now, false);
+  if(best >= 0 && score <= _slots[best].score.load(std::memory_order_relaxed) && !_requested.load()) {
+    return;
+  }
+
+  //replace the oldest frame no reader is copying, claiming it takes it out of the ready set
+  int target = -1;
+  for(int attempt = 0; attempt < (int)_slots.size() && target < 0; attempt++) {
+    int oldest = -1;
+    for(int i = 0; i < (int)_slots.size(); i++) {
+      uint32_t state = _slots[i].state.load(std::memory_order_acquire);
+      if(state & ~state_ready) {
+        continue;
+      }
+      if(oldest < 0 || !state ||
+         ((_slots[oldest].state.load(std::memory_order_relaxed) & state_ready) &&
+          _slots[i].time_ns.load(std::memory_order_relaxed) < _slots[oldest].time_ns.load(std::memory_order_relaxed))) {
+        oldest = i;
+      }
+    }
+    if(oldest < 0) {
+      return;
+    }
+    //fails if a reader pinned it meanwhile, then look again
+    uint32_t state = _slots[oldest].state.load(std::memory_order_acquire);
+    if(!(state & ~state_ready) && _slots[oldest].state.compare_exchange_strong(state, state_writing, std::memory_order_acquire)) {
+      target = oldest;
+    }
+  }
+  if(target < 0) {
+    return;
+  }
+
+  //slot buffers are reused once allocated
+  slot& s = _slots[target];
+  frame.copyTo(s.image);
+  s.seq.store(seq, std::memory_order_relaxed);
+  s.time_ns.store(now, std::memory_order_relaxed);
+  s.score.store(score, std::memory_order_relaxed);
+  s.state.store(state_ready, std::memory_order_release);
+
+  //only a waiting reader needs waking, the mutex orders this with its check so the wakeup isn't lost
+  if(_requested.exchange(false)) {
+    { std::lock_guard<std::mutex> accessLock(_mutex); }
+    _published.notify_all();
+  }
+}
+
+bool frame_snapshot::pending() const {
+  return _requested.load();
+}
+
+int frame_snapshot::take(cv::Mat& out, uint64_t& seq, int timeout_ms) {
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+  int best = -1;
+  for(;;) {
+    best = best_slot(now_ns(), false);
+    if(best < 0) {
+      //nothing from the window (e.g. only luma is being captured): ask the capture side for the next colour frame
+      std::unique_lock<std::mutex> accessLock(_mutex);
+      _requested.store(true);
+      _published.wait_until(accessLock, deadline, [&]{ return (best = best_slot(now_ns(), false)) >= 0; });
+    }
+    if(best < 0) {
+      best = best_slot(now_ns(), true);
+    }
+    if(best < 0) {
+      return -1;
+    }
+    //the slot can be claimed for a new frame between choosing and pinning it, then choose again
+    if(pin(_slots[best])) {
+      break;
+    }
+  }
+
+  //copy out without holding up the capture side, which won't reuse the slot meanwhile
+  slot& s = _slots[best];
+  uint64_t slot_seq = s.seq.load(std::memory_order_relaxed);
+  if(slot_seq != seq || out.empty()) {
+    s.image.copyTo(out);
+    seq = slot_seq;
+  }
+  s.state.fetch_sub(state_reader, std::memory_order_release);
+  return 0;
+}
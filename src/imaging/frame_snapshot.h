@@ -0,0 +1,66 @@
+#ifndef __FRAME_SNAPSHOT_H__
+#define __FRAME_SNAPSHOT_H__
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <yaml-cpp/yaml.h>
+#include <opencv2/opencv.hpp>
+
+//keeps the sharpest recent frames for snapshot readers (ai image requests), so they don't get a motion blurred frame
+//every frame is given a sharpness score (laplacian variance of a downsampled luma plane), and is only copied into the
+//small ring of held frames if it is sharper than all those already held from the last window, so copies stay rare
+class frame_snapshot {
+public:
+  //reads the ring size and window from the Imaging config section
+  frame_snapshot(YAML::Node config);
+
+  //capture side: call for every colour frame, luma (if not empty) is used for scoring instead of converting the image
+  void publish(const cv::Mat& frame, const cv::Mat& luma, uint64_t seq);
+
+  //true if a reader is waiting for the capture side to publish a frame
+  bool pending() const;
+
+  //reader side: get the sharpest frame from the window, otherwise request one and wait for the capture side to publish it
+  //falls back to the newest held frame on timeout, returns -1 if no frame has ever been published
+  //seq is in/out: if the snapshot returned has the sequence number passed in, out is assumed current and is not copied again
+  int take(cv::Mat& out, uint64_t& seq, int timeout_ms);
+
+private:
+  //slot state word: ready and writing flags, and the number of readers copying the slot out above them
+  static const uint32_t state_ready = 0x1;
+  static const uint32_t state_writing = 0x2;
+  static const uint32_t state_reader = 0x4;
+
+  struct slot {
+    cv::Mat image;
+    //only changed while the slot is marked writing, atomic so readers can compare slots while choosing one
+    std::atomic<uint64_t> seq{0};
+    std::atomic<int64_t> time_ns{0};
+    std::atomic<double> score{0};
+    std::atomic<uint32_t> state{0};
+  };
+
+  std::chrono::milliseconds _window;
+  std::vector<slot> _slots;
+
+  //slot state changes are lock-free, the mutex only backs the condition a reader waits on for a requested frame
+  std::mutex _mutex;
+  std::condition_variable _published;
+  std::atomic<bool> _requested;
+
+  //scoring buffers, capture side only
+  cv::Mat _small;
+  cv::Mat _gray;
+  cv::Mat _laplacian;
+
+  double sharpness(const cv::Mat& img);
+  //sharpest ready slot no older than the window (or the newest of any age), -1 if none
+  int best_slot(int64_t now_ns, bool any_age) const;
+  //pin a ready slot against being rewritten while it is copied out, false if it stopped being ready
+  bool pin(slot& s);
+};
+
+#endif
@@ -0,0 +1,35 @@
+#include "highgui_sink.h"
+
+#include "display_size.h"
+
+highgui_sink::highgui_sink(const std::string name, bool fullscreen) {
+  _name = name;
+  _fullscreen = fullscreen;
+  _created = false;
+}
+
+int highgui_sink::open() {
+  //the window covers the screen, which is best read from the framebuffer
+  _size = detect_display_size();
+  return 0;
+}
+
+cv::Size highgui_sink::size() const {
+  return _size;
+}
+
+void highgui_sink::show(const cv::Mat& img) {
+  if(!_created) {
+    cv::namedWindow(_name, cv::WINDOW_NORMAL);
+    if(_fullscreen) {
+      cv::setWindowProperty(_name, cv::WND_PROP_FULLSCREEN, cv::WINDOW_FULLSCREEN);
+    }
+    _created = true;
+  }
+  cv::imshow(_name, img);
+}
+
+void highgui_sink::poll() {
+  //let highgui process window events so the frame is actually drawn
+  cv::waitKey(1);
+}
@@ -0,0 +1,26 @@
+#ifndef __HIGHGUI_SINK_H__
+#define __HIGHGUI_SINK_H__
+
+#include <string>
+
+#include "display_sink.h"
+
+//shows frames in an opencv highgui window (goes through the window system)
+class highgui_sink : public display_sink {
+public:
+  highgui_sink(const std::string name, bool fullscreen);
+
+  int open() override;
+  cv::Size size() const override;
+  void show(const cv::Mat& img) override;
+  void poll() override;
+
+private:
+  std::string _name;
+  bool _fullscreen;
+  cv::Size _size;
+  //window is created by the first frame, on the thread that shows the frames
+  bool _created;
+};
+
+#endif
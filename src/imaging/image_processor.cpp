@@ -0,0 +1,65 @@
+#include "image_processor.h"
+
+image_processor::image_processor(int motion_threshold) : _edges(motion_threshold) {
+}
+
+void image_processor::set_output(cv::Size output) {
+  _zoom.set_output(output);
+}
+
+cv::Rect2f image_processor::region(int zoom) const {
+  return _zoom.region(zoom);
+}
+
+void image_processor::zoom(frame& in, frame& out, int zoom) {
+  out.seq = in.seq;
+  out.captured = in.captured;
+  out.formats = in.formats;
+
+  // remap tables are only rebuilt when zoom changes
+  // no zoom (or a device crop matching it) processes the captured buffers directly
+  if((in.formats & frame_bgr) && !_zoom.apply(in.image, out.image, zoom, in.view)) {
+    std::swap(in.image, out.image);
+  }
+  if((in.formats & frame_luma) && !_zoom.apply(in.luma, out.luma, zoom, in.view)) {
+    std::swap(in.luma, out.luma);
+  }
+}
+
+void image_processor::process(frame& out, const processing_settings& s) {
+  const bool have_bgr = (out.formats & frame_bgr);
+  const bool have_luma = (out.formats & frame_luma);
+
+  // frames captured before a mode change may not carry the colour image
+  if (s.mode != 3 && !have_bgr) {
+    cv::cvtColor(out.luma, out.image, cv::COLOR_GRAY2BGR);
+  }
+
+  if (s.mode == 2) {
+    // edge detection, overlaid in yellow on the colour image
+    _edges.apply(out.image, s.edgeno, s.scale, have_luma ? out.luma : cv::Mat());
+  }
+
+  if (s.mode == 3) {
+    // two colour (yellow/black) contrast image
+    if (have_luma) {
+      _contrast.apply_luma(out.luma, out.image, s.thresh_lev, s.threshmode, s.scale);
+    } else {
+      _contrast.apply(out.image, s.thresh_lev, s.threshmode, s.scale);
+    }
+  }
+  out.formats |= frame_bgr;
+}
+
+int image_processor::wanted_formats(int mode) {
+  // edges are detected on luma and drawn on colour, contrast only needs luma
+  return (mode == 3) ? frame_luma : (mode == 2) ? (frame_bgr | frame_luma) : frame_bgr;
+}
+
+void image_processor::set_blur(int size) {
+  _edges.set_blur(size);
+}
+
+double image_processor::take_reuse_ratio() {
+  return _edges.take_reuse_ratio();
+}
@@ -0,0 +1,57 @@
+#ifndef __IMAGE_PROCESSOR_H__
+#define __IMAGE_PROCESSOR_H__
+
+#include <opencv2/opencv.hpp>
+
+#include "frame.h"
+#include "zoom_engine.h"
+#include "edge_overlay.h"
+#include "contrast_filter.h"
+
+//display mode settings for a frame
+struct processing_settings {
+  //1 normal, 2 edges, 3 contrast
+  int mode;
+  int zoom;
+  int edgeno;
+  int thresh_lev;
+  int threshmode;
+  //detection resolution divider (1, 2 or 4)
+  int scale;
+};
+
+//zoom and mode processing of frames, independent of where frames come from or go to
+//used by the image thread and by the benchmark
+class image_processor {
+public:
+  image_processor(int motion_threshold = 0);
+
+  //size frames are zoomed to
+  void set_output(cv::Size output);
+
+  //region of the full field of view shown at a zoom level (for cropping on the camera)
+  cv::Rect2f region(int zoom) const;
+
+  //zoom the planes of in into out, buffers are swapped instead when no zoom is needed
+  //out takes in's seq, capture time and formats
+  void zoom(frame& in, frame& out, int zoom);
+
+  //apply the display mode to the zoomed frame, afterwards out.image holds the frame to show
+  void process(frame& out, const processing_settings& s);
+
+  //representations (frame_bgr/frame_luma) the capture stage should provide for a mode
+  static int wanted_formats(int mode);
+
+  //edge blur kernel size (set by the quality governor)
+  void set_blur(int size);
+
+  //fraction of edge strips reused for static scenes since the last call
+  double take_reuse_ratio();
+
+private:
+  zoom_engine _zoom;
+  edge_overlay _edges;
+  contrast_filter _contrast;
+};
+
+#endif
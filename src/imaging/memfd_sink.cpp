@@ -0,0 +1,50 @@
+#include "memfd_sink.h"
+
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <sys/mman.h>
+
+#include <spdlog/spdlog.h>
+
+memfd_sink::memfd_sink(cv::Size size) : fbdev_sink("memfd") {
+  _size = size;
+}
+
+int memfd_sink::open() {
+  close();
+
+  _type = CV_8UC4;
+  _convert = cv::COLOR_BGR2BGRA;
+  _stride = (size_t)_size.width * 4;
+  _mem_len = _stride * _size.height;
+  _pages = 1;
+  _page = 0;
+
+  _fd = memfd_create("glasses_framebuffer", 0);
+  if(_fd < 0 || ftruncate(_fd, _mem_len) == -1) {
+    spdlog::error("failed to create fake framebuffer: {}", strerror(errno));
+    close();
+    return -1;
+  }
+
+  _mem = (uint8_t*)mmap(NULL, _mem_len, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+  if(_mem == MAP_FAILED) {
+    _mem = nullptr;
+    spdlog::error("failed to map fake framebuffer: {}", strerror(errno));
+    close();
+    return -2;
+  }
+
+  clear();
+  spdlog::info("fake framebuffer {}x{} (fd {})", _size.width, _size.height, _fd);
+  return 0;
+}
+
+int memfd_sink::fd() const {
+  return _fd;
+}
+
+cv::Mat memfd_sink::screen() const {
+  return cv::Mat(_size, _type, _mem, _stride);
+}
@@ -0,0 +1,21 @@
+#ifndef __MEMFD_SINK_H__
+#define __MEMFD_SINK_H__
+
+#include "fbdev_sink.h"
+
+//fake framebuffer in anonymous shared memory (32 bit BGRA, single page), frames are composed exactly as for fbdev
+//for running and checking the display path without a framebuffer device (e.g. tests)
+class memfd_sink : public fbdev_sink {
+public:
+  memfd_sink(cv::Size size);
+
+  int open() override;
+
+  //the memory file, can be mapped or read by another process through /proc/<pid>/fd
+  int fd() const;
+
+  //the composed screen contents
+  cv::Mat screen() const;
+};
+
+#endif
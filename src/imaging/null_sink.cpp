@@ -0,0 +1,15 @@
+#include "null_sink.h"
+
+null_sink::null_sink(cv::Size size) : _size(size) {
+}
+
+int null_sink::open() {
+  return 0;
+}
+
+cv::Size null_sink::size() const {
+  return _size;
+}
+
+void null_sink::show(const cv::Mat& img) {
+}
@@ -0,0 +1,19 @@
+#ifndef __NULL_SINK_H__
+#define __NULL_SINK_H__
+
+#include "display_sink.h"
+
+//discards frames, for running the pipeline without a display (benchmarks)
+class null_sink : public display_sink {
+public:
+  null_sink(cv::Size size);
+
+  int open() override;
+  cv::Size size() const override;
+  void show(const cv::Mat& img) override;
+
+private:
+  cv::Size _size;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#include "opencv_camera.h"
+
+opencv_camera::opencv_camera(int id, int width, int height) {
+  _id = id;
+  _width = width;
+  _height = height;
+}
+
+int opencv_camera::open() {
+  if(!_capture.open(_id, cv::CAP_V4L2)) {
+    return -1;
+  }
+
+  //size is not set for debug webcams (0)
+  if(_width > 0 && _height > 0) {
+    _capture.set(cv::CAP_PROP_FRAME_WIDTH, _width);
+    _capture.set(cv::CAP_PROP_FRAME_HEIGHT, _height);
+  }
+  return 0;
+}
+
+int opencv_camera::read(frame& f, int formats) {
+  if(!_capture.read(f.image) || f.image.empty()) {
+    return -1;
+  }
+  f.captured = std::chrono::steady_clock::now();
+
+  //only BGR is available from VideoCapture, the colour image is always provided
+  f.formats = frame_bgr;
+  if(formats & frame_luma) {
+    cv::cvtColor(f.image, f.luma, cv::COLOR_BGR2GRAY);
+    f.formats |= frame_luma;
+  }
+  return 0;
+}
+
+double opencv_camera::fps() const {
+  return _capture.get(cv::CAP_PROP_FPS);
+}
+
+cv::Size opencv_camera::size() const {
+  return cv::Size((int)_capture.get(cv::CAP_PROP_FRAME_WIDTH), (int)_capture.get(cv::CAP_PROP_FRAME_HEIGHT));
+}
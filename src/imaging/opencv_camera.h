@@ -0,0 +1,25 @@
+#ifndef __OPENCV_CAMERA_H__
+#define __OPENCV_CAMERA_H__
+
+#include <opencv2/opencv.hpp>
+
+#include "camera_source.h"
+
+//capture through cv::VideoCapture
+class opencv_camera : public camera_source {
+public:
+  opencv_camera(int id, int width, int height);
+
+  int open() override;
+  int read(frame& f, int formats) override;
+  double fps() const override;
+  cv::Size size() const override;
+
+private:
+  int _id;
+  int _width;
+  int _height;
+  cv::VideoCapture _capture;
+};
+
+#endif
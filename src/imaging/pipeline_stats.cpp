@@ -0,0 +1,125 @@
+#include "pipeline_stats.h"
+
+#include <spdlog/spdlog.h>
+
+static int bucket_index(uint64_t us) {
+  //values below 4us get a bucket each, above that 4 buckets per power of two
+  if(us < 4) {
+    return (int)us;
+  }
+  int msb = 63 - __builtin_clzll(us);
+  int index = (msb - 1) * 4 + (int)((us >> (msb - 2)) & 3);
+  return std::min(index, duration_histogram::num_buckets - 1);
+}
+
+//middle of the range of durations (in us) counted by a bucket
+static double bucket_value(int index) {
+  if(index < 4) {
+    return index;
+  }
+  int msb = index / 4 + 1;
+  double width = (double)(1ull << (msb - 2));
+  return (4 + index % 4) * width + width / 2;
+}
+
+duration_histogram::counts duration_histogram::counts::operator-(const counts& since) const {
+  counts c;
+  for(int i = 0; i < num_buckets; i++) {
+    c.buckets[i] = buckets[i] - since.buckets[i];
+  }
+  c.total = total - since.total;
+  return c;
+}
+
+double duration_histogram::counts::percentile(double p) const {
+  if(!total) {
+    return 0;
+  }
+  uint64_t rank = (uint64_t)(p * (total - 1)) + 1;
+  uint64_t seen = 0;
+  for(int i = 0; i < num_buckets; i++) {
+    seen += buckets[i];
+    if(seen >= rank) {
+      return bucket_value(i) / 1000.0;
+    }
+  }
+  return bucket_value(num_buckets - 1) / 1000.0;
+}
+
+duration_histogram::duration_histogram() {
+  for(auto& b: _buckets) {
+    b.store(0);
+  }
+}
+
+void duration_histogram::record(std::chrono::steady_clock::duration d) {
+  int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+  _buckets[bucket_index(us > 0 ? us : 0)].fetch_add(1, std::memory_order_relaxed);
+}
+
+duration_histogram::counts duration_histogram::read() const {
+  counts c;
+  for(int i = 0; i < num_buckets; i++) {
+    c.buckets[i] = _buckets[i].load(std::memory_order_relaxed);
+    c.total += c.buckets[i];
+  }
+  return c;
+}
+
+pipeline_stats::pipeline_stats() {
+  _start = std::chrono::steady_clock::now();
+  _report_time = _start;
+  _reported_drops = {0, 0, 0};
+}
+
+const char* pipeline_stats::stage_name(int stage) {
+  static const char* names[num_pipeline_stages] = {
+    "capture", "zoom", "snapshot", "process", "commands", "display", "poll", "latency"
+  };
+  return names[stage];
+}
+
+void pipeline_stats::record(pipeline_stage stage, std::chrono::steady_clock::duration d) {
+  _stages[stage].record(d);
+}
+
+void pipeline_stats::report(const drops& dropped) {
+  auto now = std::chrono::steady_clock::now();
+  double secs = std::chrono::duration<double>(now - _report_time).count();
+
+  for(int i = 0; i < num_pipeline_stages; i++) {
+    duration_histogram::counts total = _stages[i].read();
+    duration_histogram::counts c = total - _reported[i];
+    _reported[i] = total;
+    if(c.total) {
+      spdlog::debug("{:>8}: p50 {:.2f} ms, p95 {:.2f} ms, p99 {:.2f} ms ({:.1f}/s)", stage_name(i),
+                    c.percentile(0.5), c.percentile(0.95), c.percentile(0.99), c.total / secs);
+    }
+  }
+  spdlog::debug("frames dropped: {} by camera, {} before processing, {} before display",
+                dropped.camera - _reported_drops.camera, dropped.capture_queue - _reported_drops.capture_queue,
+                dropped.display_queue - _reported_drops.display_queue);
+
+  _reported_drops = dropped;
+  _report_time = now;
+}
+
+nlohmann::json pipeline_stats::dump(const drops& dropped) const {
+  nlohmann::json j;
+  j["uptime_s"] = std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+  for(int i = 0; i < num_pipeline_stages; i++) {
+    duration_histogram::counts c = _stages[i].read();
+    j["stages"][stage_name(i)] = {
+      {"count", c.total},
+      {"p50_ms", c.percentile(0.5)},
+      {"p95_ms", c.percentile(0.95)},
+      {"p99_ms", c.percentile(0.99)}
+    };
+  }
+  j["dropped"] = {
+    {"camera", dropped.camera},
+    {"capture_queue", dropped.capture_queue},
+    {"display_queue", dropped.display_queue}
+  };
+  return j;
+}
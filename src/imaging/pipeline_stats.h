@@ -0,0 +1,80 @@
+#ifndef __PIPELINE_STATS_H__
+#define __PIPELINE_STATS_H__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <nlohmann/json.hpp>
+
+//fixed bucket histogram of durations, recording is lock free so any pipeline stage can write to it
+//buckets are log spaced (4 per power of two microseconds) so percentiles are within ~12% up to several seconds
+class duration_histogram {
+public:
+  static const int num_buckets = 4 * 24;
+
+  //bucket counts, used to take the difference between two points in time
+  struct counts {
+    std::array<uint64_t, num_buckets> buckets{};
+    uint64_t total = 0;
+
+    counts operator-(const counts& since) const;
+    //duration (ms) at percentile p (0-1), 0 if nothing was recorded
+    double percentile(double p) const;
+  };
+
+  duration_histogram();
+
+  void record(std::chrono::steady_clock::duration d);
+  counts read() const;
+
+private:
+  std::array<std::atomic<uint64_t>, num_buckets> _buckets;
+};
+
+//image pipeline stages that are timed
+enum pipeline_stage {
+  stage_capture,
+  stage_zoom,
+  stage_snapshot,
+  stage_process,
+  stage_commands,
+  stage_display,
+  stage_poll,
+  stage_latency,
+  num_pipeline_stages
+};
+
+//per stage timing histograms and frame drop counts for the image pipeline
+class pipeline_stats {
+public:
+  pipeline_stats();
+
+  void record(pipeline_stage stage, std::chrono::steady_clock::duration d);
+
+  //frames lost at each point of the pipeline, set by whoever reports
+  struct drops {
+    uint64_t camera;
+    uint64_t capture_queue;
+    uint64_t display_queue;
+  };
+
+  //log p50/p95/p99 of each stage since the last report
+  void report(const drops& dropped);
+
+  //percentiles and counts since startup, for the stats dump
+  nlohmann::json dump(const drops& dropped) const;
+
+  static const char* stage_name(int stage);
+
+private:
+  std::array<duration_histogram, num_pipeline_stages> _stages;
+  std::chrono::steady_clock::time_point _start;
+
+  //counts at the last report
+  std::array<duration_histogram::counts, num_pipeline_stages> _reported;
+  drops _reported_drops;
+  std::chrono::steady_clock::time_point _report_time;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include "quality_governor.h"
+
+#include <fstream>
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+//quality levels, best first: blur is reduced first, then the detection resolution, then the frame rate
+static const quality_settings levels[] = {
+  {1, 7, 1},
+  {1, 5, 1},
+  {2, 5, 1},
+  {4, 5, 1},
+  {4, 3, 1},
+  {4, 3, 2},
+};
+const int num_levels = sizeof(levels) / sizeof(levels[0]);
+
+//how often the frame times and temperature are evaluated
+const int eval_interval_ms = 1000;
+//minimum time at a level before stepping down again, and before stepping back up
+const int down_hold_ms = 1000;
+const int up_hold_ms = 5000;
+//frame time (as a fraction of the budget) that must be reached before quality is raised again
+const double up_headroom = 0.6;
+//percentile of the frame times held to the budget
+const double budget_percentile = 0.9;
+
+quality_governor::quality_governor(YAML::Node config) {
+  _enabled = config["governor"].as<bool>();
+  _budget_ms = config["governorframems"].as<double>();
+  _thermal_file = config["thermalfile"].as<std::string>();
+  _thermal_high = config["thermalhigh"].as<double>();
+  _thermal_low = config["thermallow"].as<double>();
+
+  _eval_time = std::chrono::steady_clock::now();
+  _change_time = _eval_time;
+  _level = 0;
+  _adjustments = 0;
+  _temperature = 0;
+  _thermal_warned = false;
+}
+
+double quality_governor::read_temperature() {
+  if(_thermal_file.empty()) {
+    return 0;
+  }
+
+  //sysfs thermal zones report millidegrees celsius
+  std::ifstream f(_thermal_file);
+  long millideg = 0;
+  if(!(f >> millideg)) {
+    if(!_thermal_warned) {
+      spdlog::warn("failed to read soc temperature from {}, governing on frame time only", _thermal_file);
+      _thermal_warned = true;
+    }
+    return 0;
+  }
+  return millideg / 1000.0;
+}
+
+void quality_governor::set_level(int level, const char* reason, double frame_ms) {
+  const quality_settings& s = levels[level];
+  spdlog::info("quality level {} -> {} ({}: frame {:.1f} ms, {:.1f} C): scale x{}, blur {}, fps 1/{}",
+               _level.load(), level, reason, frame_ms, _temperature.load(), s.scale_factor, s.blur_size, s.fps_divider);
+  _level = level;
+  _adjustments++;
+  _change_time = std::chrono::steady_clock::now();
+}
+
+bool quality_governor::frame_processed(double ms) {
+  if(!_enabled) {
+    return false;
+  }
+  _samples.push_back(ms);
+
+  auto now = std::chrono::steady_clock::now();
+  if(now - _eval_time < std::chrono::milliseconds(eval_interval_ms)) {
+    return false;
+  }
+  _eval_time = now;
+
+  auto pos = _samples.begin() + (size_t)(budget_percentile * (_samples.size() - 1));
+  std::nth_element(_samples.begin(), pos, _samples.end());
+  double frame_ms = *pos;
+  _samples.clear();
+
+  double temp = read_temperature();
+  _temperature = temp;
+  const bool hot = (temp > 0 && temp >= _thermal_high);
+  const bool cool = (temp <= 0 || temp <= _thermal_low);
+  const auto held = now - _change_time;
+
+  int level = _level;
+  if((frame_ms > _budget_ms || hot) && level < num_levels - 1 && held >= std::chrono::milliseconds(down_hold_ms)) {
+    set_level(level + 1, hot ? "hot" : "slow", frame_ms);
+    return true;
+  }
+  if(frame_ms < _budget_ms * up_headroom && cool && level > 0 && held >= std::chrono::milliseconds(up_hold_ms)) {
+    set_level(level - 1, "headroom", frame_ms);
+    return true;
+  }
+  return false;
+}
+
+const quality_settings& quality_governor::settings() const {
+  return levels[_level];
+}
+
+int quality_governor::level() const {
+  return _level;
+}
+
+uint64_t quality_governor::adjustments() const {
+  return _adjustments;
+}
+
+double quality_governor::temperature() const {
+  return _temperature;
+}
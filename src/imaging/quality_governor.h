@@ -0,0 +1,58 @@
+#ifndef __QUALITY_GOVERNOR_H__
+#define __QUALITY_GOVERNOR_H__
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <yaml-cpp/yaml.h>
+
+//processing settings for a quality level
+struct quality_settings {
+  //multiplier for the configured processing scale (capped at 1/4 resolution)
+  int scale_factor;
+  //edge mode blur kernel size
+  int blur_size;
+  //only every n'th captured frame is processed and shown
+  int fps_divider;
+};
+
+//steps processing quality down when frames take longer than the frame time budget or the soc gets hot,
+//and back up once there is headroom again (with hysteresis so it doesn't oscillate)
+class quality_governor {
+public:
+  //reads the governor settings from the Imaging config section
+  quality_governor(YAML::Node config);
+
+  //record the processing time of a frame, returns true if the settings have changed
+  bool frame_processed(double ms);
+
+  const quality_settings& settings() const;
+
+  //current level (0 = full quality), number of level changes and last soc temperature (0 if unknown)
+  int level() const;
+  uint64_t adjustments() const;
+  double temperature() const;
+
+private:
+  bool _enabled;
+  double _budget_ms;
+  std::string _thermal_file;
+  double _thermal_high;
+  double _thermal_low;
+
+  //processing times since the last evaluation
+  std::vector<double> _samples;
+  std::chrono::steady_clock::time_point _eval_time;
+  std::chrono::steady_clock::time_point _change_time;
+
+  std::atomic<int> _level;
+  std::atomic<uint64_t> _adjustments;
+  std::atomic<double> _temperature;
+  bool _thermal_warned;
+
+  double read_temperature();
+  void set_level(int level, const char* reason, double frame_ms);
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include "replay_camera.h"
+
+#include <thread>
+#include <spdlog/spdlog.h>
+
+replay_camera::replay_camera(const std::string file, int width, int height, const std::string format, double fps, bool loop) {
+  _file = file;
+  _width = width;
+  _height = height;
+  _yuyv = (format != "BGR");
+  _fps = fps;
+  _loop = loop;
+}
+
+int replay_camera::open() {
+  _stream.open(_file, std::ios::binary);
+  if(!_stream) {
+    spdlog::error("failed to open replay file {}", _file);
+    return -1;
+  }
+
+  _raw.resize((size_t)_width * _height * (_yuyv ? 2 : 3));
+  _next = std::chrono::steady_clock::now();
+
+  spdlog::info("replaying {}x{} {} frames from {}", _width, _height, _yuyv ? "YUYV" : "BGR", _file);
+  return 0;
+}
+
+int replay_camera::read(frame& f, int formats) {
+  if(!_stream.read((char*)_raw.data(), _raw.size())) {
+    if(!_loop) {
+      return -1;
+    }
+    //back to the first frame
+    _stream.clear();
+    _stream.seekg(0);
+    if(!_stream.read((char*)_raw.data(), _raw.size())) {
+      spdlog::error("replay file {} holds no complete frames", _file);
+      return -1;
+    }
+  }
+
+  if(_yuyv) {
+    //the Y plane is taken straight from the raw frame (expanded to full range), BGR only converted if wanted
+    cv::Mat yuyv(_height, _width, CV_8UC2, _raw.data());
+    f.formats = 0;
+    if(formats & frame_luma) {
+      cv::cvtColor(yuyv, f.luma, cv::COLOR_YUV2GRAY_YUYV);
+      expand_luma(f.luma, f.luma);
+      f.formats |= frame_luma;
+    }
+    if((formats & frame_bgr) || !f.formats) {
+      cv::cvtColor(yuyv, f.image, cv::COLOR_YUV2BGR_YUYV);
+      f.formats |= frame_bgr;
+    }
+  } else {
+    cv::Mat bgr(_height, _width, CV_8UC3, _raw.data());
+    bgr.copyTo(f.image);
+    f.formats = frame_bgr;
+    if(formats & frame_luma) {
+      cv::cvtColor(f.image, f.luma, cv::COLOR_BGR2GRAY);
+      f.formats |= frame_luma;
+    }
+  }
+
+  //replay at the recorded rate (as fast as possible if fps is 0)
+  if(_fps > 0) {
+    _next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / _fps));
+    auto now = std::chrono::steady_clock::now();
+    if(_next > now) {
+      std::this_thread::sleep_until(_next);
+    } else {
+      _next = now;
+    }
+  }
+
+  f.captured = std::chrono::steady_clock::now();
+  return 0;
+}
+
+double replay_camera::fps() const {
+  return _fps;
+}
+
+cv::Size replay_camera::size() const {
+  return cv::Size(_width, _height);
+}
@@ -0,0 +1,36 @@
+#ifndef __REPLAY_CAMERA_H__
+#define __REPLAY_CAMERA_H__
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <opencv2/opencv.hpp>
+
+#include "camera_source.h"
+
+//replays raw frames (YUYV or BGR, fixed size) recorded to a file, so the pipeline can run without a camera
+class replay_camera : public camera_source {
+public:
+  replay_camera(const std::string file, int width, int height, const std::string format, double fps, bool loop);
+
+  int open() override;
+  int read(frame& f, int formats) override;
+  double fps() const override;
+  cv::Size size() const override;
+
+private:
+  std::string _file;
+  int _width;
+  int _height;
+  bool _yuyv;
+  double _fps;
+  bool _loop;
+
+  std::ifstream _stream;
+  std::vector<uint8_t> _raw;
+
+  std::chrono::steady_clock::time_point _next;
+};
+
+#endif
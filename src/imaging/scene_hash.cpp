@@ -0,0 +1,17 @@
+#include "scene_hash.h"
+
+uint64_t scene_hash(const cv::Mat& bgr) {
+  //9x8 gray thumbnail, each bit is whether brightness falls between horizontally adjacent pixels
+  cv::Mat small, gray;
+  cv::resize(bgr, small, cv::Size(9, 8), 0, 0, cv::INTER_AREA);
+  cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+
+  uint64_t hash = 0;
+  for(int y = 0; y < 8; y++) {
+    const uint8_t* p = gray.ptr<uint8_t>(y);
+    for(int x = 0; x < 8; x++) {
+      hash = (hash << 1) | (p[x] > p[x + 1]);
+    }
+  }
+  return hash;
+}
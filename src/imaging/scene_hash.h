@@ -0,0 +1,15 @@
+#ifndef __SCENE_HASH_H__
+#define __SCENE_HASH_H__
+
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+//64 bit perceptual difference hash (dHash) of a frame: similar scenes give hashes a small hamming distance apart
+uint64_t scene_hash(const cv::Mat& bgr);
+
+//number of differing bits between two scene hashes
+inline int scene_distance(uint64_t a, uint64_t b) {
+  return __builtin_popcountll(a ^ b);
+}
+
+#endif
@@ -0,0 +1,53 @@
+#include "snapshot_encoder.h"
+#include "scene_hash.h"
+
+#include <spdlog/spdlog.h>
+
+//maximum time to wait for the capture loop to provide a snapshot frame
+const int snapshot_timeout_ms = 500;
+
+snapshot_encoder::snapshot_encoder(YAML::Node config) {
+  _width = config["snapshotwidth"].as<int>();
+  _params = { cv::IMWRITE_JPEG_QUALITY, config["snapshotquality"].as<int>() };
+
+  _frame_seq = 0;
+  _jpg_seq = 0;
+  _hash = 0;
+}
+
+int snapshot_encoder::encode(frame_snapshot& source, std::vector<uint8_t>& jpg, uint64_t& hash) {
+  std::unique_lock<std::mutex> accessLock(_mutex);
+
+  uint64_t seq = _frame_seq;
+  if(source.take(_frame, seq, snapshot_timeout_ms)) {
+    spdlog::error("no camera frame available for snapshot");
+    return -1;
+  }
+  _frame_seq = seq;
+
+  if(_jpg.empty() || seq != _jpg_seq) {
+    const cv::Mat* img = &_frame;
+
+    //scale down to requested width (0 keeps the full frame)
+    if(_width > 0 && _width < _frame.cols) {
+      cv::Size size(_width, (_frame.rows * _width + _frame.cols / 2) / _frame.cols);
+      cv::resize(_frame, _scaled, size, 0, 0, cv::INTER_AREA);
+      img = &_scaled;
+    }
+
+    if(!cv::imencode(".jpg", *img, _jpg, _params)) {
+      spdlog::error("failed to encode snapshot");
+      _jpg.clear();
+      return -2;
+    }
+    _jpg_seq = seq;
+    _hash = scene_hash(*img);
+    spdlog::debug("encoded snapshot frame {} ({}x{}, {} bytes)", seq, img->cols, img->rows, _jpg.size());
+  } else {
+    spdlog::debug("reusing encoded snapshot frame {}", seq);
+  }
+
+  jpg.assign(_jpg.begin(), _jpg.end());
+  hash = _hash;
+  return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef __SNAPSHOT_ENCODER_H__
+#define __SNAPSHOT_ENCODER_H__
+
+#include <mutex>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+#include <opencv2/opencv.hpp>
+
+#include "frame_snapshot.h"
+
+//encodes snapshot frames to jpg for ai image requests
+//buffers are reused between requests and the encoded result is cached by frame sequence number
+class snapshot_encoder {
+public:
+  snapshot_encoder(YAML::Node config);
+
+  //encode the current snapshot frame, hash is set to its scene hash
+  int encode(frame_snapshot& source, std::vector<uint8_t>& jpg, uint64_t& hash);
+
+private:
+  int _width;
+  std::vector<int> _params;
+
+  std::mutex _mutex;
+
+  cv::Mat _frame;
+  uint64_t _frame_seq;
+  cv::Mat _scaled;
+
+  std::vector<uint8_t> _jpg;
+  uint64_t _jpg_seq;
+  uint64_t _hash;
+};
+
+#endif
@@ -0,0 +1,404 @@
+#include "v4l2_camera.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <cmath>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <linux/videodev2.h>
+
+#include <spdlog/spdlog.h>
+
+//how long to wait for the driver to fill a buffer
+const int frame_timeout_s = 2;
+
+//ioctl, retried if interrupted by a signal
+static int xioctl(int fd, unsigned long request, void* arg) {
+  int r;
+  do {
+    r = ioctl(fd, request, arg);
+  } while(r == -1 && errno == EINTR);
+  return r;
+}
+
+v4l2_camera::v4l2_camera(const std::string device, int width, int height, const std::string format, int buffers, bool sensor_crop) {
+  _device = device;
+  _width = width;
+  _height = height;
+  _full_size = cv::Size(width, height);
+  _pixel_format = (format == "YUYV") ? V4L2_PIX_FMT_YUYV : (format == "NV12") ? V4L2_PIX_FMT_NV12 : V4L2_PIX_FMT_MJPEG;
+  _bytes_per_line = 0;
+  _num_buffers = buffers;
+  _fps = 0;
+
+  _fd = -1;
+  _streaming = false;
+
+  _have_sequence = false;
+  _last_sequence = 0;
+  _dropped = 0;
+
+  _sensor_crop = sensor_crop;
+  _crop_supported = false;
+  _view = cv::Rect2f(0, 0, 1, 1);
+  _crop_pending = false;
+}
+
+v4l2_camera::~v4l2_camera() {
+  close();
+}
+
+int v4l2_camera::open() {
+  close();
+
+  _fd = ::open(_device.c_str(), O_RDWR | O_NONBLOCK);
+  if(_fd < 0) {
+    spdlog::error("failed to open camera device {}: {}", _device, strerror(errno));
+    return -1;
+  }
+
+  struct v4l2_capability cap;
+  memset(&cap, 0, sizeof(cap));
+  if(xioctl(_fd, VIDIOC_QUERYCAP, &cap) == -1 ||
+     !(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE) || !(cap.capabilities & V4L2_CAP_STREAMING)) {
+    spdlog::error("{} is not a streaming video capture device", _device);
+    close();
+    return -2;
+  }
+
+  //the default crop is the full field of view, zoom crops are taken relative to it
+  _crop_supported = false;
+  _view = cv::Rect2f(0, 0, 1, 1);
+  if(_sensor_crop) {
+    struct v4l2_selection sel;
+    memset(&sel, 0, sizeof(sel));
+    sel.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    sel.target = V4L2_SEL_TGT_CROP_DEFAULT;
+    if(xioctl(_fd, VIDIOC_G_SELECTION, &sel) == 0 && sel.r.width > 0 && sel.r.height > 0) {
+      _crop_default = cv::Rect(sel.r.left, sel.r.top, sel.r.width, sel.r.height);
+      //start from the full view, the driver keeps the crop of a previous run (before S_FMT, which may follow it)
+      sel.target = V4L2_SEL_TGT_CROP;
+      _crop_supported = (xioctl(_fd, VIDIOC_S_SELECTION, &sel) == 0);
+    }
+    if(!_crop_supported) {
+      spdlog::info("camera does not support cropping, zoom will crop in software");
+    }
+  }
+
+  //request the pixel format explicitly, the driver may adjust the size
+  struct v4l2_format fmt;
+  memset(&fmt, 0, sizeof(fmt));
+  fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  fmt.fmt.pix.width = _full_size.width;
+  fmt.fmt.pix.height = _full_size.height;
+  fmt.fmt.pix.pixelformat = _pixel_format;
+  fmt.fmt.pix.field = V4L2_FIELD_ANY;
+  if(xioctl(_fd, VIDIOC_S_FMT, &fmt) == -1) {
+    spdlog::error("failed to set camera format: {}", strerror(errno));
+    close();
+    return -3;
+  }
+  if(fmt.fmt.pix.pixelformat != _pixel_format) {
+    spdlog::error("camera does not support the requested pixel format");
+    close();
+    return -3;
+  }
+  _width = fmt.fmt.pix.width;
+  _height = fmt.fmt.pix.height;
+  _bytes_per_line = fmt.fmt.pix.bytesperline;
+  _full_size = cv::Size(_width, _height);
+
+  struct v4l2_streamparm parm;
+  memset(&parm, 0, sizeof(parm));
+  parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  if(xioctl(_fd, VIDIOC_G_PARM, &parm) == 0 && parm.parm.capture.timeperframe.numerator) {
+    _fps = (double)parm.parm.capture.timeperframe.denominator / parm.parm.capture.timeperframe.numerator;
+  }
+
+  struct v4l2_requestbuffers req;
+  memset(&req, 0, sizeof(req));
+  req.count = _num_buffers;
+  req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  req.memory = V4L2_MEMORY_MMAP;
+  if(xioctl(_fd, VIDIOC_REQBUFS, &req) == -1 || req.count < 2) {
+    spdlog::error("failed to allocate camera buffers");
+    close();
+    return -4;
+  }
+
+  for(uint32_t i = 0; i < req.count; i++) {
+    struct v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = i;
+    if(xioctl(_fd, VIDIOC_QUERYBUF, &buf) == -1) {
+      spdlog::error("failed to query camera buffer: {}", strerror(errno));
+      close();
+      return -4;
+    }
+
+    void* start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, buf.m.offset);
+    if(start == MAP_FAILED) {
+      spdlog::error("failed to map camera buffer: {}", strerror(errno));
+      close();
+      return -4;
+    }
+    _buffers.push_back({start, buf.length});
+  }
+
+  int ret = start_stream();
+  if(ret) {
+    close();
+    return ret;
+  }
+
+  spdlog::info("camera {} streaming {}x{} {} at {:.1f} fps with {} buffers", _device, _width, _height,
+               (_pixel_format == V4L2_PIX_FMT_YUYV) ? "YUYV" : (_pixel_format == V4L2_PIX_FMT_NV12) ? "NV12" : "MJPEG",
+               _fps, _buffers.size());
+  return 0;
+}
+
+void v4l2_camera::close() {
+  if(_fd < 0) {
+    return;
+  }
+
+  stop_stream();
+
+  for(auto& b: _buffers) {
+    munmap(b.start, b.length);
+  }
+  _buffers.clear();
+
+  ::close(_fd);
+  _fd = -1;
+}
+
+int v4l2_camera::start_stream() {
+  for(uint32_t i = 0; i < _buffers.size(); i++) {
+    struct v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = i;
+    if(xioctl(_fd, VIDIOC_QBUF, &buf) == -1) {
+      spdlog::error("failed to queue camera buffer: {}", strerror(errno));
+      return -4;
+    }
+  }
+
+  enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  if(xioctl(_fd, VIDIOC_STREAMON, &type) == -1) {
+    spdlog::error("failed to start camera stream: {}", strerror(errno));
+    return -5;
+  }
+  _streaming = true;
+  _have_sequence = false;
+  return 0;
+}
+
+void v4l2_camera::stop_stream() {
+  if(_streaming) {
+    //also returns all buffers to userspace, so no frame from before a crop change is dequeued after it
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    xioctl(_fd, VIDIOC_STREAMOFF, &type);
+    _streaming = false;
+  }
+}
+
+void v4l2_camera::set_crop(const cv::Rect2f& region) {
+  if(!_crop_supported) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(_crop_mutex);
+  _crop_request = region;
+  _crop_pending = true;
+}
+
+int v4l2_camera::apply_crop(const cv::Rect2f& region) {
+  //sensor rectangle covering the region, rounded outwards (drivers typically want even sizes)
+  int left = _crop_default.x + (int)std::floor(region.x * _crop_default.width);
+  int top = _crop_default.y + (int)std::floor(region.y * _crop_default.height);
+  int right = _crop_default.x + (int)std::ceil((region.x + region.width) * _crop_default.width);
+  int bottom = _crop_default.y + (int)std::ceil((region.y + region.height) * _crop_default.height);
+  left &= ~1;
+  top &= ~1;
+  cv::Rect want = cv::Rect(left, top, right - left, bottom - top) & _crop_default;
+
+  //the crop can't be changed while streaming on most drivers
+  stop_stream();
+
+  struct v4l2_selection sel;
+  memset(&sel, 0, sizeof(sel));
+  sel.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  sel.target = V4L2_SEL_TGT_CROP;
+  sel.flags = V4L2_SEL_FLAG_GE;
+  sel.r.left = want.x;
+  sel.r.top = want.y;
+  sel.r.width = want.width;
+  sel.r.height = want.height;
+  int ret = xioctl(_fd, VIDIOC_S_SELECTION, &sel);
+  cv::Rect got(sel.r.left, sel.r.top, sel.r.width, sel.r.height);
+
+  //the output size follows the crop on devices without a scaler
+  struct v4l2_format fmt;
+  memset(&fmt, 0, sizeof(fmt));
+  fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  if(ret == 0 && xioctl(_fd, VIDIOC_G_FMT, &fmt) == -1) {
+    ret = -1;
+  }
+
+  //the rest of the zoom is done in software, so the device crop must contain the requested region
+  if(ret || (got & want) != want || fmt.fmt.pix.sizeimage > _buffers[0].length) {
+    spdlog::warn("camera rejected crop {}x{}+{}+{}, zoom will crop in software", want.width, want.height, want.x, want.y);
+    _crop_supported = false;
+    memset(&sel, 0, sizeof(sel));
+    sel.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    sel.target = V4L2_SEL_TGT_CROP;
+    sel.r.left = _crop_default.x;
+    sel.r.top = _crop_default.y;
+    sel.r.width = _crop_default.width;
+    sel.r.height = _crop_default.height;
+    xioctl(_fd, VIDIOC_S_SELECTION, &sel);
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    xioctl(_fd, VIDIOC_G_FMT, &fmt);
+    got = _crop_default;
+  }
+
+  _width = fmt.fmt.pix.width;
+  _height = fmt.fmt.pix.height;
+  _bytes_per_line = fmt.fmt.pix.bytesperline;
+  _view = cv::Rect2f((float)(got.x - _crop_default.x) / _crop_default.width, (float)(got.y - _crop_default.y) / _crop_default.height,
+                     (float)got.width / _crop_default.width, (float)got.height / _crop_default.height);
+  spdlog::debug("camera crop {}x{}+{}+{}, capturing {}x{}", got.width, got.height, got.x, got.y, _width, _height);
+
+  return start_stream();
+}
+
+int v4l2_camera::read(frame& f, int formats) {
+  //crop changes restart the stream, so they are made here between frames
+  if(_crop_pending.exchange(false)) {
+    cv::Rect2f region;
+    {
+      std::lock_guard<std::mutex> lock(_crop_mutex);
+      region = _crop_request;
+    }
+    if(apply_crop(region)) {
+      return -1;
+    }
+  }
+
+  if(!_streaming) {
+    return -1;
+  }
+
+  fd_set fds;
+  FD_ZERO(&fds);
+  FD_SET(_fd, &fds);
+  struct timeval tv;
+  tv.tv_sec = frame_timeout_s;
+  tv.tv_usec = 0;
+  int r = select(_fd + 1, &fds, NULL, NULL, &tv);
+  if(r <= 0) {
+    if(r == 0 || errno != EINTR) {
+      spdlog::warn("timed out waiting for camera frame");
+    }
+    return -2;
+  }
+
+  struct v4l2_buffer buf;
+  memset(&buf, 0, sizeof(buf));
+  buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  buf.memory = V4L2_MEMORY_MMAP;
+  if(xioctl(_fd, VIDIOC_DQBUF, &buf) == -1) {
+    if(errno != EAGAIN) {
+      spdlog::error("failed to dequeue camera buffer: {}", strerror(errno));
+    }
+    return -3;
+  }
+
+  //gaps in the driver sequence number are frames the driver had no free buffer for
+  if(_have_sequence && buf.sequence > _last_sequence + 1) {
+    _dropped += buf.sequence - _last_sequence - 1;
+  }
+  _last_sequence = buf.sequence;
+  _have_sequence = true;
+
+  //driver timestamps are CLOCK_MONOTONIC, the same clock as steady_clock on linux
+  if((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+    f.captured = std::chrono::steady_clock::time_point(
+      std::chrono::seconds(buf.timestamp.tv_sec) + std::chrono::microseconds(buf.timestamp.tv_usec));
+  } else {
+    f.captured = std::chrono::steady_clock::now();
+  }
+
+  f.view = _view;
+
+  int ret = 0;
+  uint8_t* data = (uint8_t*)_buffers[buf.index].start;
+  if(buf.flags & V4L2_BUF_FLAG_ERROR) {
+    ret = -4;
+  } else if(_pixel_format == V4L2_PIX_FMT_YUYV || _pixel_format == V4L2_PIX_FMT_NV12) {
+    //Y is stored natively, so luma only needs expanding to full range and BGR is only converted if wanted
+    bool yuyv = (_pixel_format == V4L2_PIX_FMT_YUYV);
+    f.formats = 0;
+    if(formats & frame_luma) {
+      if(yuyv) {
+        cv::cvtColor(cv::Mat(_height, _width, CV_8UC2, data, _bytes_per_line), f.luma, cv::COLOR_YUV2GRAY_YUYV);
+        expand_luma(f.luma, f.luma);
+      } else {
+        expand_luma(cv::Mat(_height, _width, CV_8UC1, data, _bytes_per_line), f.luma);
+      }
+      f.formats |= frame_luma;
+    }
+    if((formats & frame_bgr) || !f.formats) {
+      if(yuyv) {
+        cv::cvtColor(cv::Mat(_height, _width, CV_8UC2, data, _bytes_per_line), f.image, cv::COLOR_YUV2BGR_YUYV);
+      } else {
+        cv::cvtColor(cv::Mat(_height * 3 / 2, _width, CV_8UC1, data, _bytes_per_line), f.image, cv::COLOR_YUV2BGR_NV12);
+      }
+      f.formats |= frame_bgr;
+    }
+  } else {
+    //jpeg stores luma natively too, decoding to grayscale skips the colour conversion
+    cv::Mat jpg(1, buf.bytesused, CV_8UC1, data);
+    if(formats == frame_luma) {
+      cv::imdecode(jpg, cv::IMREAD_GRAYSCALE, &f.luma);
+      f.formats = frame_luma;
+      ret = f.luma.empty() ? -4 : 0;
+    } else {
+      cv::imdecode(jpg, cv::IMREAD_COLOR, &f.image);
+      f.formats = frame_bgr;
+      ret = f.image.empty() ? -4 : 0;
+      if(!ret && (formats & frame_luma)) {
+        cv::cvtColor(f.image, f.luma, cv::COLOR_BGR2GRAY);
+        f.formats |= frame_luma;
+      }
+    }
+  }
+
+  //hand the buffer back to the driver
+  if(xioctl(_fd, VIDIOC_QBUF, &buf) == -1) {
+    spdlog::error("failed to requeue camera buffer: {}", strerror(errno));
+    return -5;
+  }
+
+  return ret;
+}
+
+double v4l2_camera::fps() const {
+  return _fps;
+}
+
+uint64_t v4l2_camera::dropped() const {
+  return _dropped;
+}
+
+cv::Size v4l2_camera::size() const {
+  return _full_size;
+}
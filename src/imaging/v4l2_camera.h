@@ -0,0 +1,69 @@
+#ifndef __V4L2_CAMERA_H__
+#define __V4L2_CAMERA_H__
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <opencv2/opencv.hpp>
+
+#include "camera_source.h"
+
+//native v4l2 capture using mmap'd driver buffers
+//frames are converted (YUYV/NV12) or decoded (MJPEG) straight out of the driver buffer into the frame
+//with sensor_crop the zoom crop is done by the device (VIDIOC_S_SELECTION) when the driver supports it
+class v4l2_camera : public camera_source {
+public:
+  v4l2_camera(const std::string device, int width, int height, const std::string format, int buffers, bool sensor_crop);
+  ~v4l2_camera();
+
+  int open() override;
+  int read(frame& f, int formats) override;
+  double fps() const override;
+  cv::Size size() const override;
+  uint64_t dropped() const override;
+  void set_crop(const cv::Rect2f& region) override;
+
+private:
+  struct buffer {
+    void* start;
+    size_t length;
+  };
+
+  std::string _device;
+  int _width;
+  int _height;
+  uint32_t _pixel_format;
+  //frame size at the full field of view (_width/_height follow the device crop)
+  cv::Size _full_size;
+  uint32_t _bytes_per_line;
+  int _num_buffers;
+  double _fps;
+
+  int _fd;
+  std::vector<buffer> _buffers;
+  bool _streaming;
+
+  //driver frame sequence numbers, used to count dropped frames
+  bool _have_sequence;
+  uint32_t _last_sequence;
+  std::atomic<uint64_t> _dropped;
+
+  //device cropping, _crop_default is the full field of view in sensor coordinates
+  bool _sensor_crop;
+  std::atomic<bool> _crop_supported;
+  cv::Rect _crop_default;
+  cv::Rect2f _view;
+
+  //crop requested by the processing stage, applied by the capture stage between frames
+  std::mutex _crop_mutex;
+  cv::Rect2f _crop_request;
+  std::atomic<bool> _crop_pending;
+
+  void close();
+  int start_stream();
+  void stop_stream();
+  int apply_crop(const cv::Rect2f& region);
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include "zoom_engine.h"
+
+#include <cmath>
+#include <spdlog/spdlog.h>
+
+//fraction of the frame removed from each side per zoom level (95x54 pixels of a 1920x1080 frame)
+const float zoom_step_x = 95.0f / 1920;
+const float zoom_step_y = 54.0f / 1080;
+
+//how far (as a fraction of the full field of view) a device crop can be from the zoom region and still count as it
+//drivers crop to whole sensor pixels rounded outwards to even coordinates, up to 2 pixels off on a 720 line sensor
+const float crop_match = 0.002f;
+
+static bool matches(const cv::Rect2f& a, const cv::Rect2f& b) {
+  return std::fabs(a.x - b.x) <= crop_match && std::fabs(a.y - b.y) <= crop_match &&
+         std::fabs(a.x + a.width - b.x - b.width) <= crop_match && std::fabs(a.y + a.height - b.y - b.height) <= crop_match;
+}
+
+zoom_engine::zoom_engine(cv::Size output) : _output(output) {
+  _level = -1;
+}
+
+void zoom_engine::set_output(cv::Size output) {
+  _output = output;
+  _level = -1;
+}
+
+cv::Rect2f zoom_engine::region(int level) const {
+  return cv::Rect2f(level * zoom_step_x, level * zoom_step_y, 1 - (level * 2 * zoom_step_x), 1 - (level * 2 * zoom_step_y));
+}
+
+cv::Rect2f zoom_engine::crop_rect(int level) const {
+  //zoom region in input pixels, relative to the part of the view the input covers
+  cv::Rect2f r = region(level);
+  const float sx = _input.width / _view.width;
+  const float sy = _input.height / _view.height;
+  return cv::Rect2f((r.x - _view.x) * sx, (r.y - _view.y) * sy, r.width * sx, r.height * sy);
+}
+
+void zoom_engine::build_maps(int level) {
+  cv::Rect2f roi = crop_rect(level);
+
+  //map each output pixel centre back into the cropped region of the input (same sampling as cv::resize)
+  const float sx = (float)roi.width / _output.width;
+  const float sy = (float)roi.height / _output.height;
+
+  cv::Mat map_x(_output, CV_32FC1);
+  cv::Mat map_y(_output, CV_32FC1);
+  for(int y = 0; y < _output.height; y++) {
+    float* px = map_x.ptr<float>(y);
+    float* py = map_y.ptr<float>(y);
+    const float fy = (y + 0.5f) * sy - 0.5f + roi.y;
+    for(int x = 0; x < _output.width; x++) {
+      px[x] = (x + 0.5f) * sx - 0.5f + roi.x;
+      py[x] = fy;
+    }
+  }
+
+  //fixed point maps are considerably faster for cv::remap than the float versions
+  cv::convertMaps(map_x, map_y, _map_xy, _map_frac, CV_16SC2);
+  _level = level;
+
+  spdlog::debug("built zoom maps for level {} ({:.0f}x{:.0f} of {}x{} -> {}x{})", level, roi.width, roi.height,
+                _input.width, _input.height, _output.width, _output.height);
+}
+
+bool zoom_engine::apply(const cv::Mat& in, cv::Mat& out, int level, const cv::Rect2f& view) {
+  if(in.size() != _input || view != _view) {
+    //input size or device crop changed, maps no longer valid
+    _input = in.size();
+    _view = view;
+    _level = -1;
+  }
+
+  //the device may already have cropped to the zoom region (to within its pixel rounding)
+  if(_input == _output && matches(region(level), _view)) {
+    return false;
+  }
+
+  if(level != _level) {
+    build_maps(level);
+  }
+
+  //no allocation once out has been created with the correct size/type
+  out.create(_output, in.type());
+  cv::remap(in, out, _map_xy, _map_frac, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+  return true;
+}
@@ -0,0 +1,37 @@
+#ifndef __ZOOM_ENGINE_H__
+#define __ZOOM_ENGINE_H__
+
+#include <opencv2/opencv.hpp>
+
+class zoom_engine {
+public:
+  zoom_engine(cv::Size output = cv::Size());
+
+  //change the size frames are zoomed to
+  void set_output(cv::Size output);
+
+  //region of the full field of view shown at a zoom level (as a fraction of it)
+  cv::Rect2f region(int level) const;
+
+  //zoom input frame into the (persistent) output buffer
+  //view is the part of the full field of view the input covers, when the device has already cropped it
+  //returns false if no zoom is required, in which case output is not written and input should be used directly
+  bool apply(const cv::Mat& in, cv::Mat& out, int level, const cv::Rect2f& view = cv::Rect2f(0, 0, 1, 1));
+
+private:
+  cv::Size _input;
+  cv::Size _output;
+
+  //level and input view the current maps were built for (-1 if none)
+  int _level;
+  cv::Rect2f _view;
+
+  //fixed point remap tables for current zoom level
+  cv::Mat _map_xy;
+  cv::Mat _map_frac;
+
+  cv::Rect2f crop_rect(int level) const;
+  void build_maps(int level);
+};
+
+#endif
@@ -20,6 +20,13 @@ void intHandler(int dummy) {
     running = false;
 }
 
+//SIGUSR1 dumps the image pipeline and audio capture stats
+volatile sig_atomic_t dump_stats = 0;
+
+void statsHandler(int dummy) {
+    dump_stats = 1;
+}
+
 int process_args(config::config& conf, int argc, char *argv[])
 {
   conf.add_option('c', "config", "yaml config file");
@@ -89,9 +96,14 @@ int main(int argc, char *argv[]) {
 
   //setup ctrl-c handling
   signal(SIGINT, intHandler);
+  signal(SIGUSR1, statsHandler);
 
   while(running) {
     usleep(1000);
+    if(dump_stats) {
+      dump_stats = 0;
+      images.dump_stats(ctrl.dump_stats());
+    }
   }
 
   images.cancel();
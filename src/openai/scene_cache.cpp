@@ -0,0 +1,81 @@
+#include "scene_cache.h"
+
+#include <cctype>
+#include <spdlog/spdlog.h>
+
+#include "../imaging/scene_hash.h"
+
+scene_cache::scene_cache(YAML::Node config) {
+  _size = config["sceneCacheSize"].as<size_t>();
+  _max_distance = config["sceneCacheDistance"].as<int>();
+  _ttl = std::chrono::seconds(config["sceneCacheTtl"].as<int>());
+
+  _hits = 0;
+  _misses = 0;
+  _saved_ms = 0;
+}
+
+std::string scene_cache::normalise(const std::string& request) {
+  //lowercase words separated by single spaces, punctuation dropped (transcriptions vary in both)
+  std::string out;
+  for(unsigned char c: request) {
+    if(std::isalnum(c)) {
+      out += std::tolower(c);
+    } else if(std::isspace(c) && !out.empty() && out.back() != ' ') {
+      out += ' ';
+    }
+  }
+  if(!out.empty() && out.back() == ' ') {
+    out.pop_back();
+  }
+  return out;
+}
+
+bool scene_cache::find(uint64_t scene, const std::string& request, std::vector<uint8_t>& audio) {
+  if(!_size) {
+    return false;
+  }
+
+  const std::string key = normalise(request);
+  const auto now = std::chrono::steady_clock::now();
+
+  for(auto it = _entries.begin(); it != _entries.end();) {
+    if(now - it->time > _ttl) {
+      it = _entries.erase(it);
+      continue;
+    }
+
+    int distance = scene_distance(scene, it->scene);
+    if(it->request == key && distance <= _max_distance) {
+      _hits++;
+      _saved_ms += it->latency_ms;
+      spdlog::info("answered from scene cache (distance {}), saved {:.0f} ms", distance, it->latency_ms);
+      report();
+
+      audio = it->audio;
+      _entries.splice(_entries.begin(), _entries, it);
+      return true;
+    }
+    ++it;
+  }
+
+  _misses++;
+  report();
+  return false;
+}
+
+void scene_cache::report() const {
+  spdlog::info("scene cache: {} hits, {} misses ({:.0f}% hit rate), {:.1f} s saved in total", _hits, _misses,
+               100.0 * _hits / (_hits + _misses), _saved_ms / 1000);
+}
+
+void scene_cache::add(uint64_t scene, const std::string& request, const std::vector<uint8_t>& audio, double latency_ms) {
+  if(!_size) {
+    return;
+  }
+
+  _entries.push_front({scene, normalise(request), audio, latency_ms, std::chrono::steady_clock::now()});
+  while(_entries.size() > _size) {
+    _entries.pop_back();
+  }
+}
@@ -0,0 +1,47 @@
+#ifndef __SCENE_CACHE_H__
+#define __SCENE_CACHE_H__
+
+#include <list>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <yaml-cpp/yaml.h>
+
+//recent answers to ai image requests, keyed by scene hash and request text
+//a repeat of a request about (nearly) the same scene is answered from the cache instead of asking the model again
+class scene_cache {
+public:
+  //reads the cache settings from the openai config section
+  scene_cache(YAML::Node config);
+
+  //look for an answer to request about a scene within the configured hamming distance and age, true on a hit
+  bool find(uint64_t scene, const std::string& request, std::vector<uint8_t>& audio);
+
+  //store the answer to a request, latency_ms is how long it took (reported as saved on later hits)
+  void add(uint64_t scene, const std::string& request, const std::vector<uint8_t>& audio, double latency_ms);
+
+private:
+  struct entry {
+    uint64_t scene;
+    std::string request;
+    std::vector<uint8_t> audio;
+    double latency_ms;
+    std::chrono::steady_clock::time_point time;
+  };
+
+  size_t _size;
+  int _max_distance;
+  std::chrono::seconds _ttl;
+
+  //most recently used first
+  std::list<entry> _entries;
+
+  uint64_t _hits;
+  uint64_t _misses;
+  double _saved_ms;
+
+  static std::string normalise(const std::string& request);
+  void report() const;
+};
+
+#endif